@@ -2,6 +2,7 @@ add_library(usermod_neo_m8 INTERFACE)
 
 target_sources(usermod_neo_m8 INTERFACE
     ${CMAKE_CURRENT_LIST_DIR}/neo_m8.c
+    ${CMAKE_CURRENT_LIST_DIR}/neo_m8_core.c
 )
 
 target_include_directories(usermod_neo_m8 INTERFACE
@@ -1,17 +1,51 @@
 #include "neo_m8.h"
 
+// NMEA sentences the module can output, and their UBX-CFG-MSG class/ID
+// Sentence filters are bitmasks over this table, so it can't grow past 32 entries
+static const message_id_t nmea_messages[] = {
+	{"GGA", 0xF0, 0x00}, {"GLL", 0xF0, 0x01}, {"GSA", 0xF0, 0x02}, {"GSV", 0xF0, 0x03},
+	{"RMC", 0xF0, 0x04}, {"VTG", 0xF0, 0x05}, {"GRS", 0xF0, 0x06}, {"GST", 0xF0, 0x07},
+	{"ZDA", 0xF0, 0x08}, {"GBS", 0xF0, 0x09}, {"DTM", 0xF0, 0x0A}, {"GNS", 0xF0, 0x0D},
+	{"VLW", 0xF0, 0x0F}, {"TXT", 0xF0, 0x41},
+	{"PUBX,00", 0xF1, 0x00}, {"PUBX,03", 0xF1, 0x03}, {"PUBX,04", 0xF1, 0x04},
+};
+#define NMEA_MESSAGE_COUNT (sizeof(nmea_messages)/sizeof(message_id_t))
+
+// Periodic UBX messages that can be named in set_message_rate()
+static const message_id_t ubx_messages[] = {
+	{"NAV-POSLLH", 0x01, 0x02}, {"NAV-STATUS", 0x01, 0x03}, {"NAV-DOP", 0x01, 0x04}, {"NAV-PVT", 0x01, 0x07},
+	{"NAV-VELNED", 0x01, 0x12}, {"NAV-TIMEGPS", 0x01, 0x20}, {"NAV-TIMEUTC", 0x01, 0x21}, {"NAV-SAT", 0x01, 0x35},
+	{"MON-HW", 0x0A, 0x09}, {"TIM-TP", 0x0D, 0x01},
+};
+#define UBX_MESSAGE_COUNT (sizeof(ubx_messages)/sizeof(message_id_t))
+
+// Baud rates the watchdog looks for the module at, most likely first - set_baudrate() only accepts these, so the module can always be found again
+static const uint32_t baud_rates[] = {9600, 38400, 115200, 57600, 19200, 230400, 460800, 4800};
+#define BAUD_RATE_COUNT (sizeof(baud_rates)/sizeof(baud_rates[0]))
+
+// Last good fix and TTFF log - survives deep sleep and resets, validated by its magic number after a power cycle
+static RTC_NOINIT_ATTR rtc_aiding_t rtc_aiding;
+
+// Set once a driver has been created since the ESP32 booted - ordinary RAM, so every reset and deep sleep wakeup clears it, but a
+// MicroPython soft reset (which doesn't restart the chip) doesn't. Only that first driver's start counts as this boot's
+static uint8_t boot_driver_created = 0;
+
+// Time to first 3D fix histogram, and the upper limit (s) of each of its bins - the last bin is everything longer
+static RTC_NOINIT_ATTR rtc_profile_t rtc_profile;
+static const uint16_t profile_histogram_limits[PROFILE_HISTOGRAM_BINS - 1] = {2, 5, 10, 15, 20, 30, 45, 60, 90, 120, 180, 300};
+
 mp_obj_t neo_m8_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args){
 	/**
 	 * Checks all the given arguments, tests the micropython UART object, and handles initialization of the driver
 	 * Also initializes the micropython object which is passed back
 	*/
 	uart_port_t uart_num;
-	gpio_num_t uart_tx_pin, uart_rx_pin;
+	gpio_num_t uart_tx_pin, uart_rx_pin, pps_pin = -1;
 	uint8_t uart_id;
 	esp_err_t err;
 
-	// Checking arguments
-	mp_arg_check_num(n_args, n_kw, 3, 3, false);
+	// Checking arguments - the 4th (PPS pin) is optional
+	mp_arg_check_num(n_args, n_kw, 3, 4, false);
 
 	// Getting arguments data
 	uart_tx_pin = mp_obj_get_uint(args[0]);
@@ -25,6 +59,13 @@ mp_obj_t neo_m8_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
 	if (!GPIO_IS_VALID_GPIO(uart_rx_pin) || !GPIO_IS_VALID_OUTPUT_GPIO(uart_tx_pin)){
 		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid UART pin numbers"));
 	}
+	if (n_args == 4){
+		pps_pin = mp_obj_get_int(args[3]);
+
+		if (!GPIO_IS_VALID_GPIO(pps_pin)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid PPS pin number"));
+		}
+	}
 
 	if (uart_id == 1){
 		uart_num = UART_NUM_1;
@@ -67,7 +108,7 @@ mp_obj_t neo_m8_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
 
 	// Creating the ESP-IDF UART - 512 byte RXbuf, 0 byte TXbuf (as I want writing UART info to be blocking, so that
 	// the code doesn't go looking for ACKs/NACKs before a command has been sent)
-	err = uart_driver_install(uart_num, 512, 0, 0, NULL, 0);
+	err = uart_driver_install(uart_num, UART_RX_BUFFER_LENGTH, 0, 0, NULL, 0);
 	if (err != ESP_OK){
    		mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART driver install failed: %s"), esp_err_to_name(err));
 	}
@@ -78,13 +119,120 @@ mp_obj_t neo_m8_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
 	// Initialising required data in the "self" object
 	self->base.type = &neo_m8_type;
 	self->uart_number = uart_num;
+	self->uart_buffer_length = UART_RX_BUFFER_LENGTH;
 	self->buffer_length = 0;
 
+	self->frame_length = 0;
+	self->frame_state = FRAME_IDLE;
+	self->sentence_filter = NMEA_FILTER_ALL;
+	self->ubx_ack_sequence = 0;
+	self->ubx_ack_result = -1;
+	self->ubx_ack_class = 0;
+	self->ubx_ack_id = 0;
+	self->leap_seconds = GPS_LEAP_SECONDS;
+	self->leap_seconds_valid = 0;
+	self->leap_seconds_polled_us = 0;
+
     // Setting all data to 0
     memset(&self->data, 0, sizeof(gps_data_t));
+    self->data.velocity_time_of_day_ms = -1;
+    memset(&self->satellites, 0, sizeof(gsv_table_t));
+    memset(&self->satellites_staging, 0, sizeof(gsv_table_t));
+    memset(&self->gsa, 0, sizeof(gsa_table_t));
+    self->fix_policy.qualities = FIX_POLICY_DEFAULT_QUALITIES;
+    self->fix_policy.min_satellites = 0;
+    self->fix_policy.max_pdop = 0;
+    memset(&self->kalman, 0, sizeof(kalman_t));
+    memset(&self->history, 0, sizeof(fix_history_t));
+    memset(&self->track, 0, sizeof(track_log_t));
+    self->track.file = MP_OBJ_NULL;
+    memset(&self->recorder, 0, sizeof(stream_recorder_t));
+    self->recorder.file = MP_OBJ_NULL;
+    memset(&self->geofences, 0, sizeof(geofence_set_t));
+    memset(&self->enu, 0, sizeof(enu_frame_t));
+    self->mga_ack_sequence = 0;
+    self->navdb_file = MP_OBJ_NULL;
+    self->power_mode = POWER_MODE_CONTINUOUS;
+    self->update_period_ms = 0;
+    self->first_fix_logged = boot_driver_created;
+    self->aided = 0;
+    self->profile.accuracy_threshold_mm = PROFILE_DEFAULT_ACCURACY_MM;
+    memset(&self->watchdog, 0, sizeof(watchdog_t));
+    self->watchdog.timeout_ms = WATCHDOG_DEFAULT_TIMEOUT_MS;
+    self->watchdog.last_byte_us = esp_timer_get_time();
+    memset(&self->rf, 0, sizeof(rf_monitor_t));
+    self->rf.callback = mp_const_none;
+    memset(&self->accuracy, 0, sizeof(accuracy_t));
+    self->accuracy.time_of_day_ms = -1;
+    self->accuracy.velocity_time_of_day_ms = -1;
+    memset(&self->pubx, 0, sizeof(pubx_t));
+    memset(&self->rate, 0, sizeof(nav_rate_t));
+
+    // The first driver since the ESP32 booted times its start from the boot, with the UART coming up now. Any later one (after a soft
+    // reset, or a second driver) finds the module already running, so times from now and stays out of the histogram
+    if (boot_driver_created){
+        profile_start(self, esp_timer_get_time(), 0);
+    }
+    else {
+        profile_start(self, 0, 1);
+    }
+    profile_milestone(self, MILESTONE_UART_UP, esp_timer_get_time());
+    boot_driver_created = 1;
+
+	self->time_received_us = 0;
+	self->chunk_received_us = 0;
+	memset(&self->received_time, 0, sizeof(utc_time_t));
+
+	// Setting up the PPS timepulse interrupt, if a pin was given
+	self->pps_pin = pps_pin;
+	memset(&self->pps, 0, sizeof(pps_t));
+
+	if (pps_pin != -1){
+		neo_m8_obj_t* pps_driver = MP_STATE_PORT(neo_m8_pps_driver);
+
+		// Only one driver at a time can have the PPS interrupt - a new driver on the same pin takes it over from the old one
+		if (pps_driver != NULL){
+			if (pps_driver->pps_pin != pps_pin){
+				mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("PPS is already in use by another driver"));
+			}
+
+			pps_driver->pps_pin = -1;
+		}
+
+		gpio_config_t pps_config = {
+			.pin_bit_mask = 1ULL << pps_pin,
+			.mode = GPIO_MODE_INPUT,
+			.pull_up_en = GPIO_PULLUP_DISABLE,
+			.pull_down_en = GPIO_PULLDOWN_DISABLE,
+			.intr_type = GPIO_INTR_POSEDGE,
+		};
+
+		err = gpio_config(&pps_config);
+		if (err != ESP_OK){
+			mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("PPS pin config failed: %s"), esp_err_to_name(err));
+		}
+
+		// The ISR service may already have been installed (e.g. by machine.Pin), which is fine
+		err = gpio_install_isr_service(0);
+		if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)){
+			mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("GPIO ISR service install failed: %s"), esp_err_to_name(err));
+		}
+
+		gpio_isr_handler_remove(pps_pin);
+		err = gpio_isr_handler_add(pps_pin, pps_isr_handler, self);
+		if (err != ESP_OK){
+			mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("PPS interrupt setup failed: %s"), esp_err_to_name(err));
+		}
+
+		// The ISR holds a pointer to this object, so it's kept reachable for the garbage collector
+		MP_STATE_PORT(neo_m8_pps_driver) = self;
+	}
 
 	vTaskDelay(pdMS_TO_TICKS(100));
 
+	// Aiding the module with the last fix from before the reset/deep sleep, if there is one
+	self->aided = rtc_aid(self);
+
 	return MP_OBJ_FROM_PTR(self);
 }
 
@@ -145,627 +293,4843 @@ static int8_t nmea_checksum(char *nmea_sentence, uint8_t length){
 
 static void update_buffer_internal(neo_m8_obj_t* self){
 	/**
-	 * Function to handle writing data into a 512-byte sliding window buffer
+	 * Function to handle reading UART data into the 512-byte sliding window buffer
+	 * Data goes through the framing layer first, so only complete, valid NMEA sentences that pass the sentence filter end up in the buffer
 	*/
 	int16_t length_read;
-	size_t data_bytes_available;
+	uint16_t total_read = 0;
+	size_t data_bytes_available = 0;
+	uint8_t chunk[UART_CHUNK_LENGTH];
 
-	// Checking for potential buffer overflow
+	// Checking for potential buffer overflow - the backlog is skipped so parsing catches up, but while recording it's recorded first, so
+	// the recorded stream has no gaps
     uart_get_buffered_data_len(self->uart_number, &data_bytes_available);
-	if (data_bytes_available > 500){
-        uart_flush_input(self->uart_number);
+	if (data_bytes_available > self->uart_buffer_length - 12){
+		if (self->recorder.file != MP_OBJ_NULL){
+			record_backlog(self, data_bytes_available);
+		}
+		else {
+        	uart_flush_input(self->uart_number);
+		}
+		self->frame_state = FRAME_IDLE;
+	}
+
+	rf_poll(self);
+	pubx_poll(self);
+	leap_seconds_poll(self);
+
+	// Reading UART data in chunks - only the first read waits for data to arrive
+	// Capped at one buffer's worth per call, so a fast data stream can't keep this looping forever
+	length_read = uart_read_bytes(self->uart_number, chunk, UART_CHUNK_LENGTH, 5);
+	self->chunk_received_us = esp_timer_get_time();
+
+	if ((length_read > 0) && (self->profile.milestone_us[MILESTONE_FIRST_BYTE] == -1)){
+		profile_milestone(self, MILESTONE_FIRST_BYTE, self->chunk_received_us);
 	}
 
-    if (self->buffer_length == 512){
-        // Sliding the window a fixed amount 448 bytes
-        memmove(self->buffer, self->buffer + 448, 64);
-		self->buffer_length = 64;
+	while (length_read > 0){
+		frame_bytes(self, chunk, length_read);
+		total_read += length_read;
+
+		if (self->recorder.file != MP_OBJ_NULL){
+			record_bytes(&(self->recorder), chunk, length_read);
+		}
+
+		if ((length_read < UART_CHUNK_LENGTH) || (total_read >= INTERNAL_BUFFER_LENGTH)){
+			break;
+		}
+
+		length_read = uart_read_bytes(self->uart_number, chunk, UART_CHUNK_LENGTH, 0);
+		self->chunk_received_us = esp_timer_get_time();
 	}
 
-    // Reading UART data into the buffer
-    length_read = uart_read_bytes(self->uart_number, self->buffer + self->buffer_length, 512 - self->buffer_length, 5);
+	// Writing out a filled recorder block only once everything read has been parsed
+	record_flush(self);
 
 	if (length_read < 0){
 		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART reading error"));
 	}
 
-    self->buffer_length += length_read;
+	watchdog_check(self, total_read);
 }
 
-static void get_sentence(neo_m8_obj_t *self, nmea_sentence_data_t* output, char* desired_sentence){
+static void record_bytes(stream_recorder_t* recorder, const uint8_t* data, uint16_t length){
 	/**
-     * Looks for a certain NMEA sentence, returns a pointer in the buffer to that sentence
-	 * Times out after 1 second of running
+	 * Copies raw UART bytes into the recorder's active block
+	 * When it fills up, the blocks are swapped and the full one is marked as pending, to be written by record_flush()
 	*/
-    uint8_t sentence_length;
-    int16_t start_pos = 0, end_pos = 0;
-	uint64_t start_time = esp_timer_get_time();
-	char nmea_sentence_type[4];
-
-    // Function times out if it's running for more than 0.1 seconds
-    while (esp_timer_get_time() - start_time < 2e5){
-        update_buffer_internal(self);
-
-        start_pos = find_in_char_array((char *) self->buffer, self->buffer_length, '$', end_pos);
-        // Minimum NMEA sentence length seems to be 20 characters, so can skip 20 characters to search more efficiently
-        end_pos = find_in_char_array((char *) self->buffer, self->buffer_length, '\n', start_pos+20);
+	uint16_t space;
 
-		if ((start_pos == -1) || (end_pos == -1)){
-			continue;
+	while (length > 0){
+		space = RECORD_BLOCK_LENGTH - recorder->block_length;
+		if (space > length){
+			space = length;
 		}
 
-        sentence_length = end_pos - start_pos;
+		memcpy(recorder->blocks + recorder->active*RECORD_BLOCK_LENGTH + recorder->block_length, data, space);
+		recorder->block_length += space;
+		recorder->bytes_recorded += space;
+		data += space;
+		length -= space;
 
-		// Checking the NMEA checksum
-        if (nmea_checksum((char*)(self->buffer+start_pos), sentence_length) != 1){
-			continue;
+		if (recorder->block_length == RECORD_BLOCK_LENGTH){
+			recorder->active = 1 - recorder->active;
+			recorder->block_length = 0;
+			recorder->pending = 1;
 		}
+	}
+}
 
-        // Extracting sentence type
-        strncpy(nmea_sentence_type, (char*)(self->buffer+start_pos+3), 3);
-		nmea_sentence_type[3] = '\0';
-
-        // Checking if it's the sentence type we want
-        if (strcmp(nmea_sentence_type, desired_sentence) == 0){
-            output->sentence_start = self->buffer + start_pos;
-            output->length = sentence_length;
+static void record_backlog(neo_m8_obj_t* self, size_t length){
+	/**
+	 * Reads a backed-up UART buffer straight into the recorder without parsing it
+	 * Full blocks are written out as they fill, as the backlog can be more than the two blocks hold
+	*/
+	uint8_t chunk[UART_CHUNK_LENGTH];
+	int16_t length_read;
 
-            return;
+	while (length > 0){
+		length_read = uart_read_bytes(self->uart_number, chunk, (length < UART_CHUNK_LENGTH) ? length : UART_CHUNK_LENGTH, 0);
+		if (length_read <= 0){
+			break;
 		}
-    }
-
-    output->sentence_start = NULL;
-    output->length = 0;
 
-    return;
+		record_bytes(&(self->recorder), chunk, length_read);
+		record_flush(self);
+		length -= length_read;
+	}
 }
 
-static void extract_timestamp(char* nmea_section, char* timestamp_out){
+static void record_flush(neo_m8_obj_t* self){
 	/**
-	 * Utility to take a segment of an NMEA sentence containing the timestamp and format it into a nice, human-readable form.
+	 * Writes out the recorder's full block, if there is one waiting
+	 * This is a plain blocking write from whichever call filled the block - there's no background writer, so that call takes as long as the flash write
 	*/
+	stream_recorder_t* recorder = &(self->recorder);
 
-	timestamp_out[0] = nmea_section[0];
-	timestamp_out[1] = nmea_section[1];
-	timestamp_out[2] = ':';
-	timestamp_out[3] = nmea_section[2];
-	timestamp_out[4] = nmea_section[3];
-	timestamp_out[5] = ':';
-	timestamp_out[6] = nmea_section[4];
-	timestamp_out[7] = nmea_section[5];
-	timestamp_out[8] = '\0';
+	if (recorder->pending){
+		recorder->pending = 0;
+		record_write(self, recorder->blocks + (1 - recorder->active)*RECORD_BLOCK_LENGTH, RECORD_BLOCK_LENGTH);
+	}
 }
 
-static void extract_lat_long(char* nmea_section, float* output){
+static void record_write(neo_m8_obj_t* self, const uint8_t* block, uint16_t length){
 	/**
-	 * Utility to take the latitude/longitude section of an NMEA sentence and convert it into degrees and decimal minutes
+	 * Writes a recorder block to the file
+	 * If the write fails, recording is stopped and an OSError raised
 	*/
-	uint8_t i;
-	int8_t pos_degrees_end, degrees;
-	float minutes;
+	int error = 0;
 
-	size_t length = strlen(nmea_section);
+	if (mp_stream_rw(self->recorder.file, (void*)block, length, &error, MP_STREAM_RW_WRITE) != length){
+		record_close(self);
+		mp_raise_OSError((error != 0) ? error : MP_EIO);
+	}
+}
 
-	// Finding the end of the degrees part of the lat/long string
-	pos_degrees_end = find_in_char_array(nmea_section, length, '.', 0);
+static void record_close(neo_m8_obj_t* self){
+	/**
+	 * Closes the recording file and frees its blocks, without writing anything
+	*/
+	stream_recorder_t* recorder = &(self->recorder);
 
-	if (pos_degrees_end <= 1){
-		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid NMEA sentence input"));
+	if (recorder->file != MP_OBJ_NULL){
+		mp_stream_close(recorder->file);
+		recorder->file = MP_OBJ_NULL;
 	}
 
-	// Extracting the degrees value
-	pos_degrees_end -= 2;
-	char degrees_char[pos_degrees_end+1];
-	degrees_char[pos_degrees_end] = '\0';
-
-	for (i = 0; i < pos_degrees_end; i++){
-		degrees_char[i] = nmea_section[i];
+	if (recorder->blocks != NULL){
+		m_del(uint8_t, recorder->blocks, 2*RECORD_BLOCK_LENGTH);
+		recorder->blocks = NULL;
 	}
+}
 
-	degrees = atoi(degrees_char);
+static void append_to_buffer(neo_m8_obj_t* self, const uint8_t* data, uint16_t length){
+	/**
+	 * Appends a framed sentence to the sliding window buffer
+	 * If there isn't enough space, the oldest sentences are dropped to make room
+	*/
+	int16_t keep_from;
 
-	// Extracting the minutes value
-	char minutes_char[length - pos_degrees_end + 1];
-	minutes_char[length - pos_degrees_end] = '\0';
+	if (self->buffer_length + length > INTERNAL_BUFFER_LENGTH){
+		// Sliding the window up to the start of the first sentence that can be kept
+		keep_from = find_in_char_array((char *) self->buffer, self->buffer_length, '$', self->buffer_length + length - INTERNAL_BUFFER_LENGTH);
 
-	for (i = pos_degrees_end; i < length; i++){
-		minutes_char[i - pos_degrees_end] = nmea_section[i];
+		if (keep_from == -1){
+			self->buffer_length = 0;
+		}
+		else {
+			memmove(self->buffer, self->buffer + keep_from, self->buffer_length - keep_from);
+			self->buffer_length -= keep_from;
+		}
 	}
 
-	minutes = atof(minutes_char);
-
-	// Combining and saving them
-	*output = (degrees + minutes/60);
+	memcpy(self->buffer + self->buffer_length, data, length);
+	self->buffer_length += length;
 }
 
-static int8_t ubx_ack_nack(neo_m8_obj_t *self){
-	uint64_t start_time = esp_timer_get_time();
+static void frame_bytes(neo_m8_obj_t* self, const uint8_t* data, uint16_t length){
+	/**
+	 * The framing layer - splits the raw UART byte stream into NMEA sentences and UBX frames
+	 * NMEA sentences that don't pass the sentence filter are dropped as soon as their header has arrived
+	 * Anything that isn't part of a sentence/frame is discarded
+	*/
 	uint16_t i;
+	uint8_t byte;
 
-	// This function times out after 1s of looking for an ACK/NACK
-    while (esp_timer_get_time() - start_time < 1e6){
-		vTaskDelay(pdMS_TO_TICKS(10));
+	for (i = 0; i < length; i++){
+		byte = data[i];
 
-		update_buffer_internal(self);
+		// A '$' always starts a new NMEA sentence, unless it's part of a binary UBX frame ('$' is never a valid sync character or class)
+		if ((byte == '$') && ((self->frame_state != FRAME_UBX) || (self->frame_length < 3))){
+			if ((self->frame_state == FRAME_NMEA) || (self->frame_state == FRAME_UBX)){
+				watchdog_garbage(self, self->frame_length);
+			}
 
-		// Making sure no buffer underflow is possible
-		if (self->buffer_length < 4){
+			self->frame[0] = byte;
+			self->frame_length = 1;
+			self->frame_state = FRAME_NMEA;
 			continue;
 		}
 
-		// Searching for ACKs/NACKs
-		for (i = 0; i < self->buffer_length-3; i++){
-			if ((self->buffer[i] == 0xB5) && (self->buffer[i+1] == 0x62) && (self->buffer[i+2] == 0x05)){
-
-				// NACK
-				if (self->buffer[i+3] == 0x00){
-					return 0;
+		switch (self->frame_state){
+			case FRAME_IDLE:
+				if (byte == 0xB5){
+					self->frame[0] = byte;
+					self->frame_length = 1;
+					self->frame_state = FRAME_UBX;
 				}
-				// ACK
-				else if (self->buffer[i+3] == 0x01){
-					return 1;
+				else if (self->watchdog.skip_bytes > 0){
+					self->watchdog.skip_bytes--;
 				}
-			}
-		}
-	}
-
-	// Nothing found
-	return -1;
-}
+				else {
+					watchdog_garbage(self, 1);
+				}
+				break;
 
-static int8_t parse_gga(neo_m8_obj_t* self){
-    /**
-     * Parses the GGA NMEA sentence
-     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
-    */
-    nmea_sentence_data_t gga_sentence;
-    char gga_copy[83], *gga_split[14];
-    uint8_t i;
+			case FRAME_NMEA_DROP:
+				if (byte == '\n'){
+					self->frame_state = FRAME_IDLE;
+				}
+				break;
+
+			case FRAME_NMEA:
+				// Sentence is longer than NMEA 0183 allows - it's garbage (u-blox's proprietary PUBX sentences are allowed to be longer)
+				// The rest of it is skipped up to its line ending, so nothing later in it can be mistaken for the start of a frame
+				if (self->frame_length == ((self->frame[1] == 'P') ? PUBX_MAX_LENGTH : NMEA_MAX_LENGTH)){
+					watchdog_garbage(self, self->frame_length + 1);
+					self->frame_state = (byte == '\n') ? FRAME_IDLE : FRAME_NMEA_DROP;
+					break;
+				}
 
-    // Collecting sentence position in buffer
-    get_sentence(self, &gga_sentence, "GGA\0");
+				self->frame[self->frame_length] = byte;
+				self->frame_length++;
 
-    // Checking for null pointer
-    if (gga_sentence.sentence_start == NULL){
-        return -1;
-    }
+				// Every sentence type (including "$PUBX,00") is identifiable from the first 8 characters
+				if ((self->frame_length == 8) && (self->sentence_filter != NMEA_FILTER_ALL)){
+					int8_t index = nmea_message_index(self->frame);
 
-    // Creating a copy of the GGA sentence as strtok is destructive
-    strncpy(gga_copy, (char*)(gga_sentence.sentence_start), gga_sentence.length);
-    gga_copy[gga_sentence.length] = '\0';
+					if ((index == -1) || !(self->sentence_filter & (1UL << index))){
+						self->frame_state = FRAME_NMEA_DROP;
+						break;
+					}
+				}
 
-    // Splitting the GGA sentence up into sections, which can then be processed
-	char* token = strtok(gga_copy, ",");
-	for (i = 0; token != NULL; i++){
-		gga_split[i] = token;
+				if (byte == '\n'){
+					handle_nmea_frame(self);
+					self->frame_state = FRAME_IDLE;
+				}
+				break;
 
-		token = strtok(NULL, ",");
-	}
+			case FRAME_UBX:
+				self->frame[self->frame_length] = byte;
+				self->frame_length++;
 
-    // If not enough fields OR status flag indicates bad fix, then return zero
-	if ((i < 8) || (strcmp(gga_split[6], "1") != 0)){
-        return 0;
+				// Checking the second sync character, and that the class is one the module actually uses
+				// so a stray 0xB5 in line noise can't swallow the NMEA sentences after it
+				if (((self->frame_length == 2) && (byte != 0x62)) || ((self->frame_length == 3) && !ubx_class_valid(byte))){
+					watchdog_garbage(self, self->frame_length);
+					self->frame_state = FRAME_IDLE;
+				}
+				else if (self->frame_length == 6){
+					// Header complete - 6 header bytes + payload + 2 checksum bytes
+					self->frame_expected_length = 8 + (self->frame[4] | (self->frame[5] << 8));
+
+					// Frames too big for the framing buffer are dropped, and the framing layer resyncs on the next sentence/frame
+					if (self->frame_expected_length > FRAME_MAX_LENGTH){
+						self->watchdog.skip_bytes = self->frame_expected_length - 6;
+						self->frame_state = FRAME_IDLE;
+					}
+				}
+				else if ((self->frame_length > 6) && (self->frame_length == self->frame_expected_length)){
+					handle_ubx_frame(self);
+					self->frame_state = FRAME_IDLE;
+				}
+				break;
+		}
 	}
+}
 
-    // Extracting latitude in degrees decimal minutes
-    extract_lat_long(gga_split[2], &(self->data.latitude));
+static void handle_nmea_frame(neo_m8_obj_t* self){
+	/**
+	 * Handles a complete NMEA sentence from the framing layer
+	 * GSV sentences are decoded straight into the satellite table, PUBX,00 is kept for parse_pubx(), everything else goes into the buffer for the parsers
+	 * GSA sentences are also decoded into the used satellite table, as each epoch has one per constellation and the parsers only see the last
+	 * The time in GGA/RMC/PUBX,00 sentences is noted against when they arrived, for gps_time_now()
+	*/
+	int32_t time_of_day_ms, date_days = -1;
+	char* date_field;
+	uint8_t pubx = (strncmp((char*)(self->frame+1), "PUBX,00,", 8) == 0);
 
-    if (strcmp(gga_split[3], "S") == 0){
-        self->data.latitude *= -1;
+	if (nmea_checksum((char*)(self->frame), self->frame_length) != 1){
+		watchdog_garbage(self, self->frame_length);
+		return;
 	}
 
-    // Extracting longitude in degrees decimal minutes
-    extract_lat_long(gga_split[4], &(self->data.longitude));
+	watchdog_frame(self);
+	profile_milestone(self, MILESTONE_FIRST_NMEA, self->chunk_received_us);
 
-	if (strcmp(gga_split[5], "W") == 0){
-        self->data.longitude *= -1;
+	// Startup profiling - fix type from GSA, and an accuracy estimate from the GGA HDOP
+	if ((self->profile.milestone_us[MILESTONE_FIX_ACCURATE] == -1) || (self->profile.milestone_us[MILESTONE_FIX_3D] == -1)){
+		profile_fix(self);
 	}
 
-    // Extracting HDOP value, converting it to horizontal position error
-    self->data.position_error = atof(gga_split[8])*2.5;
-
-    // Extracting altitude
-    self->data.altitude = atof(gga_split[9]);
-
-	// Extracting geoid separation
-    self->data.geosep = atof(gga_split[11]);
-
-    // Extracting GMT timestamp in hh:mm:ss format
-    extract_timestamp(gga_split[1], self->data.timestamp);
-
-    // Removing this NMEA sentence from the buffer
-    memmove(gga_sentence.sentence_start, gga_sentence.sentence_start + gga_sentence.length, self->buffer_length-(gga_sentence.sentence_start-self->buffer)-gga_sentence.length);
-    self->buffer_length -= gga_sentence.length;
+	if (pubx || (strncmp((char*)(self->frame+3), "GGA,", 4) == 0) || (strncmp((char*)(self->frame+3), "RMC,", 4) == 0)){
+		time_of_day_ms = extract_time_of_day((char*)(self->frame + (pubx ? 9 : 7)));
 
-    return 1;
-}
+		if (self->frame[3] == 'R'){
+			date_field = nmea_field((char*)(self->frame), self->frame_length, 9);
 
-static int8_t parse_rmc(neo_m8_obj_t* self){
-    /**
-     * Parses the RMC NMEA sentence
-     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
-    */
-    nmea_sentence_data_t rmc_sentence;
-    char rmc_copy[83], *rmc_split[13];
-    float cog;
-    uint8_t i;
+			if (date_field != NULL){
+				date_days = extract_date(date_field);
+			}
+		}
 
-    // Collecting RMC sentence position in buffer
-    get_sentence(self, &rmc_sentence, "RMC\0");
+		if (time_of_day_ms >= 0){
+			update_utc_time(&(self->received_time), time_of_day_ms, date_days);
+			self->time_received_us = self->chunk_received_us;
 
-	// Checking for null pointers
-    if (rmc_sentence.sentence_start == NULL){
-        return -1;
+			pair_pps(self, time_of_day_ms);
+		}
 	}
 
-	// Creating a copy of the RMC sentence as strtok is destructive
-	// Uses fixed length of 83 bytes, the maximum sentence length in NMEA 0183 Version 4.10
-    strncpy(rmc_copy, (char*)(rmc_sentence.sentence_start), rmc_sentence.length);
-    rmc_copy[rmc_sentence.length] = '\0';
+	if (pubx){
+		decode_pubx_accuracy(self);
 
-    // Splitting the RMC sentence up into sections, which can then be processed
-	char* token = strtok(rmc_copy, ",");
-	for (i = 0; token != NULL; i++){
-		rmc_split[i] = token;
+		memcpy(self->pubx.sentence, self->frame, self->frame_length);
+		self->pubx.sentence[self->frame_length] = '\0';
+		self->pubx.length = self->frame_length;
+		self->pubx.pending = 1;
+		return;
+	}
 
-		token = strtok(NULL, ",");
+	if (strncmp((char*)(self->frame+3), "GSV", 3) == 0){
+		self->gsa.in_progress = 0;
+		decode_gsv(self, (char*)(self->frame), self->frame_length);
+		return;
 	}
 
-    // If not enough fields OR status flag indicates bad fix, then return zero
-	if ((i < 8) || (strcmp(rmc_split[2], "A") != 0)){
-        return 0;
+	if (strncmp((char*)(self->frame+3), "GSA,", 4) == 0){
+		decode_gsa(self);
+	}
+	else {
+		self->gsa.in_progress = 0;
 	}
 
-    // Extracting timestamp
-    extract_timestamp(rmc_split[1], self->data.timestamp);
+	append_to_buffer(self, self->frame, self->frame_length);
+}
 
-	// Extracting SOG (knots)
-    self->data.sog = atof(rmc_split[7]);
+static void handle_ubx_frame(neo_m8_obj_t* self){
+	/**
+	 * Handles a complete UBX frame from the framing layer
+	 * Frames with a bad checksum are dropped
+	*/
+	uint8_t ck_a, ck_b;
+	uint16_t length = self->frame_length;
 
-	// Extracting COG (degrees)
-    cog = atof(rmc_split[8]);
+	ubx_checksum(self->frame + 2, length - 4, &ck_a, &ck_b);
 
-	// If the COG is > 360 degrees, it means it's picked out the "date" field instead
-    // Which happens if the SOG isn't high enough for an accurate COG to be calculate. So -1 is saved instead
-    if (cog > 360.0f){
-        self->data.cog = -1;
+	if ((ck_a != self->frame[length-2]) || (ck_b != self->frame[length-1])){
+		watchdog_garbage(self, length);
+		return;
 	}
-    else {
-        self->data.cog = cog;
-    }
 
-    // Extracting date
-    strncpy(self->data.date, rmc_split[i-2], 6);
-
-    // Removing this NMEA sentence from the buffer
-    memmove(rmc_sentence.sentence_start, rmc_sentence.sentence_start + rmc_sentence.length, self->buffer_length-(rmc_sentence.sentence_start-self->buffer)-rmc_sentence.length);
-    self->buffer_length -= rmc_sentence.length;
+	watchdog_frame(self);
+
+	// UBX-ACK-ACK/UBX-ACK-NAK - only counted if its payload (the class/ID being acknowledged) matches the packet ubx_ack_nack() is waiting on,
+	// so ACKs for packets sent in the background can't complete someone else's request
+	// Packets sent without waiting (the watchdog's configuration replay, adaptive rate switches) are resolved here too. One of those for the
+	// same class/ID was sent before the packet being waited on, so its ACK comes first, and isn't counted for ubx_ack_nack() as well
+	if (self->frame[2] == 0x05){
+		if ((length == 10) && !ubx_pending_ack(&(self->watchdog.replay_ack), self->frame, self->chunk_received_us) &&
+		    !ubx_pending_ack(&(self->rate.switch_ack), self->frame, self->chunk_received_us) &&
+		    (self->frame[6] == self->ubx_ack_class) && (self->frame[7] == self->ubx_ack_id)){
+			self->ubx_ack_result = (self->frame[3] == 0x01) ? 1 : 0;
+			self->ubx_ack_sequence++;
+		}
+	}
 
-    return 1;
-}
+	// UBX-NAV-PVT/UBX-NAV-POSLLH - the receiver's accuracy estimates
+	else if ((self->frame[2] == 0x01) && (self->frame[3] == 0x07) && (length == NAV_PVT_FRAME_LENGTH)){
+		decode_nav_pvt(self);
+	}
+	else if ((self->frame[2] == 0x01) && (self->frame[3] == 0x02) && (length == NAV_POSLLH_FRAME_LENGTH)){
+		decode_nav_posllh(self);
+	}
 
-static int8_t parse_gsa(neo_m8_obj_t* self){
-    /**
-     * Parses the GSA NMEA sentence
-     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
-    */
-    nmea_sentence_data_t gsa_sentence;
-    char field[6];
-    uint8_t i, comma_count = 0, field_end = 0;
+	// UBX-NAV-VELNED - north/east/down velocity
+	else if ((self->frame[2] == 0x01) && (self->frame[3] == 0x12) && (length == NAV_VELNED_FRAME_LENGTH)){
+		decode_nav_velned(self);
+	}
 
-    // Getting pointer to the start of the GSA sentence in the buffer
-    get_sentence(self, &gsa_sentence, "GSA\0");
+	// UBX-NAV-TIMEGPS - leap seconds, only taken once the receiver flags them as valid (bit 2 of valid) rather than its firmware default
+	else if ((self->frame[2] == 0x01) && (self->frame[3] == 0x20) && (length == NAV_TIMEGPS_FRAME_LENGTH)){
+		if (self->frame[6 + 11] & 0x04){
+			self->leap_seconds = (int8_t)(self->frame[6 + 10]);
+			self->leap_seconds_valid = 1;
+		}
+	}
 
-    // Checking for null pointer
-    if (gsa_sentence.sentence_start == NULL){
-        return -1;
+	// UBX-MON-HW - RF/antenna status, polled by rf_monitor()
+	else if ((self->frame[2] == 0x0A) && (self->frame[3] == 0x09) && (length == MON_HW_FRAME_LENGTH)){
+		rf_decode(self);
 	}
 
-    // Searching backwards through the GSA sentence for the field
-    for (i = gsa_sentence.length; i > 0; i--){
-        // Looking for commas
-        if (*(gsa_sentence.sentence_start + i) == ','){
-            comma_count ++;
+	// UBX-CFG-RATE - the response to a poll from cfg_rate_read()
+	else if ((self->frame[2] == 0x06) && (self->frame[3] == 0x08) && (length == CFG_RATE_FRAME_LENGTH)){
+		self->rate.meas_rate_ms = self->frame[6] | (self->frame[7] << 8);
+		self->rate.nav_rate = self->frame[8] | (self->frame[9] << 8);
+		self->rate.time_ref = self->frame[10] | (self->frame[11] << 8);
+		self->rate.sequence++;
+	}
 
-            // First comma found is the end of the VDOP field
-            if (comma_count == 1){
-                field_end = i;
-            }
+	// UBX-MGA-ACK-DATA0
+	else if ((self->frame[2] == 0x13) && (self->frame[3] == 0x60) && (length == 16)){
+		self->mga_ack_type = self->frame[6];
+		self->mga_ack_msg_id = self->frame[9];
+		memcpy(self->mga_ack_payload_start, self->frame + 10, 4);
+		self->mga_ack_sequence++;
+	}
 
-            // Find second comma at start of VDOP field
-            if (comma_count == 2){
-                break;
-            }
-        }
-    }
-    // If there's some invalid GSA sentence and it doesn't have 2 commas, return
-    if (comma_count != 2){
-        return -1;
-    }
+	// UBX-MGA-DBD while save_navdb() is running - saved to its file exactly as received
+	else if ((self->frame[2] == 0x13) && (self->frame[3] == 0x80) && (self->navdb_file != MP_OBJ_NULL) && (self->navdb_error == 0)){
+		if ((mp_stream_rw(self->navdb_file, self->frame, length, &(self->navdb_error), MP_STREAM_RW_WRITE) != length) && (self->navdb_error == 0)){
+			self->navdb_error = MP_EIO;
+		}
 
-    // Copying the field out
-    strncpy(field, (char*)(gsa_sentence.sentence_start + i + 1), field_end-i-1);
-    field[field_end-i-1] = '\0';
+		self->navdb_count++;
+		self->navdb_last_us = self->chunk_received_us;
+	}
+}
 
-    // Extracting vertical error
-    self->data.vertical_error = atof(field)*5;
+static uint8_t ubx_class_valid(uint8_t msg_class){
+	/**
+	 * Checks a UBX class byte against the classes the NEO-M8 uses:
+	 * NAV, RXM, INF, ACK, CFG, UPD, MON, AID, TIM, ESF, MGA, LOG, SEC, HNR
+	*/
+	const uint64_t valid_classes = (1ULL << 0x01) | (1ULL << 0x02) | (1ULL << 0x04) | (1ULL << 0x05) | (1ULL << 0x06) | (1ULL << 0x09) | (1ULL << 0x0A)
+	                             | (1ULL << 0x0B) | (1ULL << 0x0D) | (1ULL << 0x10) | (1ULL << 0x13) | (1ULL << 0x21) | (1ULL << 0x27) | (1ULL << 0x28);
 
-    // Removing this NMEA sentence from the buffer
-    memmove(gsa_sentence.sentence_start, gsa_sentence.sentence_start + gsa_sentence.length, self->buffer_length-(gsa_sentence.sentence_start-self->buffer)-gsa_sentence.length);
-    self->buffer_length -= gsa_sentence.length;
+	if (msg_class > 0x28){
+		return 0;
+	}
 
-    return 1;
+	return (valid_classes >> msg_class) & 1;
 }
 
-mp_obj_t update_buffer(mp_obj_t self_in){
+static int8_t nmea_message_index(const uint8_t* sentence){
 	/**
-	 * Exposing the update_buffer_internal function to micropython
+	 * Finds which entry of the NMEA message table a sentence is
+	 * Standard sentences are matched on the 3 characters after the talker ID, proprietary (PUBX) sentences on the whole header
+	 * Returns the index, or -1 if the sentence type isn't known
 	*/
-	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	uint8_t i;
 
-	update_buffer_internal(self);
+	for (i = 0; i < NMEA_MESSAGE_COUNT; i++){
+		if (nmea_messages[i].name[0] == 'P'){
+			if (strncmp((char*)(sentence+1), nmea_messages[i].name, strlen(nmea_messages[i].name)) == 0){
+				return i;
+			}
+		}
+		else if (strncmp((char*)(sentence+3), nmea_messages[i].name, 3) == 0){
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static int8_t message_lookup(const char* name, size_t length){
+	/**
+	 * Finds a message in the NMEA message table by name (e.g. "GGA" or "PUBX,00")
+	 * Returns the index, or -1 if it isn't in the table
+	*/
+	uint8_t i;
+
+	for (i = 0; i < NMEA_MESSAGE_COUNT; i++){
+		if ((strlen(nmea_messages[i].name) == length) && (strncmp(nmea_messages[i].name, name, length) == 0)){
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void get_sentence(neo_m8_obj_t *self, nmea_sentence_data_t* output, char* desired_sentence){
+	/**
+     * Looks for a certain NMEA sentence, returns a pointer in the buffer to that sentence
+	 * Times out after 1 second of running
+	*/
+    uint8_t sentence_length;
+    int16_t start_pos = 0, end_pos = 0;
+	uint64_t start_time = esp_timer_get_time();
+	char nmea_sentence_type[4];
+
+    // Function times out if it's running for more than 0.1 seconds
+    while (esp_timer_get_time() - start_time < 2e5){
+        update_buffer_internal(self);
+
+        start_pos = find_in_char_array((char *) self->buffer, self->buffer_length, '$', end_pos);
+        // Minimum NMEA sentence length seems to be 20 characters, so can skip 20 characters to search more efficiently
+        end_pos = find_in_char_array((char *) self->buffer, self->buffer_length, '\n', start_pos+20);
+
+		if ((start_pos == -1) || (end_pos == -1)){
+			continue;
+		}
+
+        sentence_length = end_pos - start_pos;
+
+		// Checking the NMEA checksum
+        if (nmea_checksum((char*)(self->buffer+start_pos), sentence_length) != 1){
+			continue;
+		}
+
+        // Extracting sentence type
+        strncpy(nmea_sentence_type, (char*)(self->buffer+start_pos+3), 3);
+		nmea_sentence_type[3] = '\0';
+
+        // Checking if it's the sentence type we want
+        if (strcmp(nmea_sentence_type, desired_sentence) == 0){
+            output->sentence_start = self->buffer + start_pos;
+            output->length = sentence_length;
+
+            return;
+		}
+    }
+
+    output->sentence_start = NULL;
+    output->length = 0;
+
+    return;
+}
+
+static int32_t extract_time_of_day(char* nmea_section){
+	/**
+	 * Utility to convert the hhmmss.ss time section of an NMEA sentence into milliseconds since UTC midnight
+	 * Keeps the fractional seconds (up to 3 decimal places). Returns -1 if the section isn't a valid time
+	*/
+	uint8_t i;
+	int32_t fraction = 0, scale = 100;
+
+	for (i = 0; i < 6; i++){
+		if ((nmea_section[i] < '0') || (nmea_section[i] > '9')){
+			return -1;
+		}
+	}
+
+	if (nmea_section[6] == '.'){
+		for (i = 7; (nmea_section[i] >= '0') && (nmea_section[i] <= '9') && (scale > 0); i++){
+			fraction += (nmea_section[i] - '0')*scale;
+			scale /= 10;
+		}
+	}
+
+	return (((nmea_section[0]-'0')*10 + (nmea_section[1]-'0'))*3600
+	      + ((nmea_section[2]-'0')*10 + (nmea_section[3]-'0'))*60
+	      + ((nmea_section[4]-'0')*10 + (nmea_section[5]-'0')))*1000 + fraction;
+}
+
+static int32_t extract_date(char* nmea_section){
+	/**
+	 * Utility to convert the ddmmyy date section of an NMEA sentence into days since 1970-01-01
+	 * Returns -1 if the section isn't a valid date
+	*/
+	uint8_t i;
+
+	for (i = 0; i < 6; i++){
+		if ((nmea_section[i] < '0') || (nmea_section[i] > '9')){
+			return -1;
+		}
+	}
+
+	return days_from_civil(2000 + (nmea_section[4]-'0')*10 + (nmea_section[5]-'0'),
+	                       (nmea_section[2]-'0')*10 + (nmea_section[3]-'0'),
+	                       (nmea_section[0]-'0')*10 + (nmea_section[1]-'0'));
+}
+
+static int32_t days_from_civil(int32_t year, uint8_t month, uint8_t day){
+	/**
+	 * Converts a (proleptic Gregorian) calendar date into days since 1970-01-01
+	 * Counts from March, so the leap day is at the end of the year
+	*/
+	int32_t era, year_of_era, day_of_year;
+
+	if (month <= 2){
+		year--;
+	}
+
+	era = year / 400;
+	year_of_era = year - era*400;
+	day_of_year = (153*(month > 2 ? month - 3 : month + 9) + 2)/5 + day - 1;
+
+	return era*146097 + year_of_era*365 + year_of_era/4 - year_of_era/100 + day_of_year - 719468;
+}
+
+static void civil_from_days(int32_t days, int32_t* year, uint8_t* month, uint8_t* day){
+	/**
+	 * Converts days since 1970-01-01 back into a calendar date - the inverse of days_from_civil()
+	*/
+	int32_t era, day_of_era, year_of_era, day_of_year, shifted_month;
+
+	days += 719468;
+	era = days / 146097;
+	day_of_era = days - era*146097;
+	year_of_era = (day_of_era - day_of_era/1460 + day_of_era/36524 - day_of_era/146096) / 365;
+	day_of_year = day_of_era - (365*year_of_era + year_of_era/4 - year_of_era/100);
+	shifted_month = (5*day_of_year + 2)/153;
+
+	*day = day_of_year - (153*shifted_month + 2)/5 + 1;
+	*month = (shifted_month < 10) ? shifted_month + 3 : shifted_month - 9;
+	*year = year_of_era + era*400 + (*month <= 2);
+}
+
+static void update_utc_time(utc_time_t* time, int32_t time_of_day_ms, int32_t date_days){
+	/**
+	 * Updates a UTC time from a sentence's time of day and date (-1 if the sentence doesn't have one, e.g. GGA)
+	 * Sentences without a date use the last known one, moved on a day if the time has wrapped past midnight since
+	*/
+	if (time_of_day_ms < 0){
+		return;
+	}
+
+	if (date_days >= 0){
+		time->date_days = date_days;
+	}
+	else if (time_of_day_ms + 43200000 < (int32_t)(time->time_of_day_ms)){
+		time->date_days++;
+	}
+
+	time->time_of_day_ms = time_of_day_ms;
+	time->utc_us = ((int64_t)(time->date_days)*86400000 + time_of_day_ms)*1000;
+}
+
+static char* nmea_field(char* sentence, uint8_t length, uint8_t index){
+	/**
+	 * Finds the start of a comma-separated field in an NMEA sentence without copying or modifying it
+	 * Returns NULL if the sentence doesn't have that many fields
+	*/
+	uint8_t i;
+
+	for (i = 0; (i < length) && (index > 0); i++){
+		if (sentence[i] == ','){
+			index--;
+		}
+	}
+
+	if (index > 0){
+		return NULL;
+	}
+
+	return sentence + i;
+}
+
+static void IRAM_ATTR pps_isr_handler(void* arg){
+	/**
+	 * GPIO interrupt handler for the PPS timepulse - latches the time of the rising edge
+	*/
+	pps_edge(&(((neo_m8_obj_t*) arg)->pps), esp_timer_get_time());
+}
+
+static void pair_pps(neo_m8_obj_t* self, int32_t time_of_day_ms){
+	/**
+	 * Pairs the latest PPS edge with the UTC second a whole-second GGA/RMC carries - see pps_pair()
+	*/
+	if ((self->pps_pin == -1) || (time_of_day_ms % 1000 != 0)){
+		return;
+	}
+
+	// A leap second (23:59:60) makes UTC repeat a second, and pps_pair() never moves the pairing earlier - so it starts again
+	if (time_of_day_ms == 86400000){
+		self->pps.paired_count = 0;
+		return;
+	}
+
+	pps_pair(&(self->pps), self->time_received_us, self->received_time.utc_us);
+}
+
+static void utc_to_gps_time(int64_t utc_us, int8_t leap_seconds, uint16_t* week, uint32_t* time_of_week_ms){
+	/**
+	 * Converts UTC (microseconds since 1970-01-01) into GPS week number and time of week (milliseconds)
+	 * GPS time started at 1980-01-06 and doesn't have leap seconds, so is leap_seconds ahead of UTC
+	*/
+	int64_t gps_ms = utc_us/1000 - GPS_EPOCH_UNIX_MS + leap_seconds*1000LL;
+
+	if (gps_ms < 0){
+		*week = 0;
+		*time_of_week_ms = 0;
+		return;
+	}
+
+	*week = gps_ms / 604800000LL;
+	*time_of_week_ms = gps_ms % 604800000LL;
+}
+
+static void format_timestamp(int64_t utc_us, char* timestamp_out){
+	/**
+	 * Utility to format a UTC time (microseconds since 1970-01-01) as "YYYY-MM-DDThh:mm:ss.sssZ"
+	 * timestamp_out needs space for 25 characters
+	*/
+	int32_t days = utc_us / 86400000000LL, year;
+	uint32_t time_of_day_ms = (utc_us / 1000) % 86400000;
+	uint8_t month, day;
+
+	civil_from_days(days, &year, &month, &day);
+
+	snprintf(timestamp_out, 25, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", (int)year, month, day,
+	         (int)(time_of_day_ms/3600000), (int)((time_of_day_ms/60000) % 60), (int)((time_of_day_ms/1000) % 60), (int)(time_of_day_ms % 1000));
+}
+
+static int32_t extract_lat_long(char* nmea_section){
+	/**
+	 * Utility to take the latitude/longitude section (dddmm.mmmmm) of an NMEA sentence and convert it into 1e-7 degrees
+	 * Done in integer maths, so none of the module's precision is lost
+	*/
+	int16_t pos_degrees_end;
+	int32_t degrees = 0, minutes_e5 = 0, scale = 10000;
+	uint8_t i;
+
+	size_t length = strlen(nmea_section);
+
+	// Finding the end of the degrees part of the lat/long string
+	pos_degrees_end = find_in_char_array(nmea_section, length, '.', 0);
+
+	if (pos_degrees_end <= 1){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid NMEA sentence input"));
+	}
+
+	// Extracting the degrees value - everything before the last 2 digits of whole minutes
+	pos_degrees_end -= 2;
+
+	for (i = 0; i < pos_degrees_end; i++){
+		degrees = degrees*10 + (nmea_section[i] - '0');
+	}
+
+	// Extracting the minutes value, as 1e-5 minutes
+	minutes_e5 = ((nmea_section[pos_degrees_end] - '0')*10 + (nmea_section[pos_degrees_end+1] - '0'))*100000;
+
+	for (i = pos_degrees_end + 3; (i < length) && (scale > 0); i++){
+		minutes_e5 += (nmea_section[i] - '0')*scale;
+		scale /= 10;
+	}
+
+	// Combining them - 1e-5 minutes is 1/60 * 1e-3 degrees, rounded to the nearest 1e-7 degrees
+	return degrees*10000000 + (minutes_e5*100 + 30)/60;
+}
+
+static uint8_t split_nmea_sentence(char* sentence, char** fields, uint8_t max_fields){
+	/**
+	 * Splits a (copied, null-terminated) NMEA sentence into its comma-separated fields in place
+	 * Unlike strtok, empty fields are kept - so field indexes always match the NMEA specification
+	 * Stops at the checksum delimiter. Returns the number of fields found
+	*/
+	uint8_t field_count = 1;
+	char* character;
+
+	fields[0] = sentence;
+
+	for (character = sentence; *character != '\0'; character++){
+		if ((*character == '*') || (*character == '\r') || (*character == '\n')){
+			*character = '\0';
+			break;
+		}
+
+		if (*character == ','){
+			*character = '\0';
+
+			if (field_count == max_fields){
+				break;
+			}
+
+			fields[field_count] = character + 1;
+			field_count++;
+		}
+	}
+
+	return field_count;
+}
+
+static int8_t gsv_talker_index(char first, char second){
+	/**
+	 * Maps an NMEA talker ID onto an index into the per-talker GSV state
+	 * 0=GPS/SBAS (GP), 1=GLONASS (GL), 2=Galileo (GA), 3=BeiDou (GB/BD), 4=QZSS (GQ), 5=combined (GN)
+	 * Returns -1 for an unknown talker
+	*/
+	if ((first == 'G') && (second == 'P')){
+		return 0;
+	}
+	if ((first == 'G') && (second == 'L')){
+		return 1;
+	}
+	if ((first == 'G') && (second == 'A')){
+		return 2;
+	}
+	if (((first == 'G') && (second == 'B')) || ((first == 'B') && (second == 'D'))){
+		return 3;
+	}
+	if ((first == 'G') && (second == 'Q')){
+		return 4;
+	}
+	if ((first == 'G') && (second == 'N')){
+		return 5;
+	}
+
+	return -1;
+}
+
+static const message_id_t* find_message(const char* name, size_t length){
+	/**
+	 * Finds a message by name in either the NMEA or UBX message table (e.g. "GSV" or "NAV-PVT")
+	 * Returns NULL if it isn't in either
+	*/
+	int8_t index;
+	uint8_t i;
+
+	index = message_lookup(name, length);
+
+	if (index != -1){
+		return &nmea_messages[index];
+	}
+
+	for (i = 0; i < UBX_MESSAGE_COUNT; i++){
+		if ((strlen(ubx_messages[i].name) == length) && (strncmp(ubx_messages[i].name, name, length) == 0)){
+			return &ubx_messages[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void ubx_checksum(const uint8_t* data, uint16_t length, uint8_t* ck_a, uint8_t* ck_b){
+	/**
+	 * Calculates the UBX checksum (8-bit Fletcher) over the class, ID, length and payload bytes of a frame
+	*/
+	uint16_t i;
+
+	*ck_a = 0;
+	*ck_b = 0;
+
+	for (i = 0; i < length; i++){
+		*ck_a += data[i];
+		*ck_b += *ck_a;
+	}
+}
+
+static void ubx_write_packet(neo_m8_obj_t* self, uint8_t msg_class, uint8_t msg_id, const uint8_t* payload, uint16_t length){
+	/**
+	 * Wraps a payload up into a UBX packet (sync characters, class, ID, length, checksum) and writes it to the UART
+	*/
+	uint8_t packet[UBX_MAX_PAYLOAD_LENGTH + 8];
+	int16_t bytes_written;
+
+	packet[0] = 0xB5;
+	packet[1] = 0x62;
+	packet[2] = msg_class;
+	packet[3] = msg_id;
+	packet[4] = length & 0xFF;
+	packet[5] = length >> 8;
+
+	memcpy(packet + 6, payload, length);
+	ubx_checksum(packet + 2, length + 4, &packet[length+6], &packet[length+7]);
+
+	bytes_written = uart_write_bytes(self->uart_number, packet, length + 8);
+
+	if (bytes_written != length + 8){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	}
+
+	// Configuration is cached, so the watchdog can re-send it if the module resets and loses it
+	if (msg_class == 0x06){
+		config_cache(&(self->watchdog), packet, length + 8);
+	}
+}
+
+static int8_t ubx_ack_nack(neo_m8_obj_t *self, uint8_t msg_class, uint8_t msg_id){
+	/**
+	 * Waits up to 1s for the framing layer to receive a UBX-ACK-ACK or UBX-ACK-NAK for the packet with the given class/ID
+	 * The packet being waited on is put back afterwards, in case this is nested inside another wait
+	 * Returns 1 for an ACK, 0 for a NACK and -1 if nothing was received
+	*/
+	uint64_t start_time = esp_timer_get_time();
+	uint8_t sequence = self->ubx_ack_sequence;
+	uint8_t outer_class = self->ubx_ack_class, outer_id = self->ubx_ack_id;
+	int8_t result = -1;
+
+	self->ubx_ack_class = msg_class;
+	self->ubx_ack_id = msg_id;
+
+    while (esp_timer_get_time() - start_time < UBX_ACK_TIMEOUT_US){
+		vTaskDelay(pdMS_TO_TICKS(10));
+
+		update_buffer_internal(self);
+
+		if (self->ubx_ack_sequence != sequence){
+			result = self->ubx_ack_result;
+			break;
+		}
+	}
+
+	self->ubx_ack_class = outer_class;
+	self->ubx_ack_id = outer_id;
+
+	return result;
+}
+
+static void ubx_pending_start(ubx_pending_t* pending, uint8_t msg_class, uint8_t msg_id){
+	/**
+	 * Notes a UBX packet that has just been sent without waiting for its ACK, for the framing layer to resolve (see ubx_pending_ack())
+	*/
+	pending->sent_us = esp_timer_get_time();
+	pending->msg_class = msg_class;
+	pending->msg_id = msg_id;
+	pending->waiting = 1;
+	pending->result = -1;
+}
+
+static uint8_t ubx_pending_ack(ubx_pending_t* pending, const uint8_t* frame, int64_t received_us){
+	/**
+	 * Resolves a packet sent without waiting, given a UBX-ACK-ACK/NAK frame from the framing layer - if it's for that packet's class/ID,
+	 * and arrived within UBX_ACK_TIMEOUT_US of it being sent (after that, the ACK is taken to be for something else)
+	 * The result is then 1 for an ACK and 0 for a NACK. It stays -1 if the sender gives up waiting first
+	 * Returns 1 if the frame was for this packet, 0 if not
+	*/
+	if (!pending->waiting || (frame[6] != pending->msg_class) || (frame[7] != pending->msg_id) || (received_us - pending->sent_us > UBX_ACK_TIMEOUT_US)){
+		return 0;
+	}
+
+	pending->result = (frame[3] == 0x01) ? 1 : 0;
+	pending->waiting = 0;
+
+	return 1;
+}
+
+static void config_cache(watchdog_t* watchdog, const uint8_t* packet, uint16_t length){
+	/**
+	 * Keeps a copy of a UBX-CFG packet sent to the module, replacing any earlier one that set the same thing (for UBX-CFG-MSG, the same message)
+	 * Packets stay in the order they were last sent, which is the order they're re-sent in. If the cache is full, the oldest is dropped
+	 * Polls, port settings (UBX-CFG-PRT - replaying a baud rate change would leave the UART behind), resets (UBX-CFG-RST),
+	 * saves (UBX-CFG-CFG) and anything too long for a slot aren't cached
+	*/
+	config_packet_t* cached;
+	uint8_t i;
+
+	if ((length <= 8) || (length > WATCHDOG_CONFIG_MAX_LENGTH) || (packet[3] == 0x00) || (packet[3] == 0x04) || (packet[3] == 0x09)){
+		return;
+	}
+
+	for (i = 0; i < watchdog->config_count; i++){
+		cached = &(watchdog->config[i]);
+
+		if ((cached->packet[3] == packet[3]) && ((packet[3] != 0x01) || (memcmp(cached->packet + 6, packet + 6, 2) == 0))){
+			break;
+		}
+	}
+
+	if ((i == watchdog->config_count) && (watchdog->config_count == WATCHDOG_CONFIG_SLOTS)){
+		i = 0;
+	}
+
+	if (i < watchdog->config_count){
+		memmove(&(watchdog->config[i]), &(watchdog->config[i+1]), (watchdog->config_count - i - 1)*sizeof(config_packet_t));
+		watchdog->config_count--;
+	}
+
+	cached = &(watchdog->config[watchdog->config_count]);
+	memcpy(cached->packet, packet, length);
+	cached->length = length;
+	watchdog->config_count++;
+}
+
+static void watchdog_frame(neo_m8_obj_t* self){
+	/**
+	 * Notes a valid sentence/frame from the framing layer - the module is alive and at the right baud rate
+	*/
+	self->watchdog.last_frame_us = self->chunk_received_us;
+	self->watchdog.frame_count++;
+}
+
+static void watchdog_garbage(neo_m8_obj_t* self, uint16_t length){
+	/**
+	 * Notes bytes the framing layer had to throw away (outside any sentence/frame, or in one that turned out to be invalid)
+	*/
+	self->watchdog.garbage_count += length;
+	self->watchdog.window_garbage += length;
+}
+
+static void watchdog_check(neo_m8_obj_t* self, uint16_t bytes_read){
+	/**
+	 * The watchdog's supervisor, run at the end of every read
+	 * Triggers a recovery if most of the last window of bytes was garbage (the baud rate is probably wrong), or if nothing at all has
+	 * arrived for the timeout (skipped while the GNSS is stopped or in a power save mode, where the module is meant to go quiet)
+	 * After each failed recovery, the window and timeout are doubled (up to 16x), so a disconnected module doesn't block every read
+	*/
+	watchdog_t* watchdog = &(self->watchdog);
+
+	if (bytes_read > 0){
+		watchdog->last_byte_us = self->chunk_received_us;
+		watchdog->byte_count += bytes_read;
+		watchdog->window_bytes += bytes_read;
+	}
+
+	if (watchdog->state != WATCHDOG_IDLE){
+		watchdog_step(self);
+		return;
+	}
+
+	if (watchdog->timeout_ms == 0){
+		return;
+	}
+
+	if (watchdog->window_bytes >= (WATCHDOG_GARBAGE_WINDOW << watchdog->failures)){
+		// More than 3/4 garbage
+		if (4*(uint64_t)(watchdog->window_garbage) > 3*(uint64_t)(watchdog->window_bytes)){
+			watchdog_recover(self, WATCHDOG_GARBAGE);
+			return;
+		}
+
+		watchdog->window_bytes = 0;
+		watchdog->window_garbage = 0;
+	}
+
+	if (!watchdog->paused && (self->power_mode == POWER_MODE_CONTINUOUS) &&
+	    (esp_timer_get_time() - watchdog->last_byte_us > ((1000*(int64_t)(watchdog->timeout_ms)) << watchdog->failures))){
+		watchdog_recover(self, WATCHDOG_SILENT);
+	}
+}
+
+static void watchdog_probe_start(neo_m8_obj_t* self){
+	/**
+	 * Starts listening for the module at the UART's current baud rate - resyncs the framing layer, throwing away anything half received
+	 * at the old baud rate, and polls UBX-NAV-STATUS in case the module's periodic output is off
+	*/
+	uint8_t empty[1];
+
+	uart_flush_input(self->uart_number);
+	self->frame_state = FRAME_IDLE;
+	self->watchdog.skip_bytes = 0;
+
+	ubx_write_packet(self, 0x01, 0x03, empty, 0);
+}
+
+static uint8_t watchdog_probe(neo_m8_obj_t* self){
+	/**
+	 * Listens for a valid sentence/frame at the UART's current baud rate (see watchdog_probe_start())
+	 * Returns 1 if one arrives within WATCHDOG_PROBE_US, 0 otherwise
+	*/
+	uint32_t frame_count = self->watchdog.frame_count;
+	uint8_t chunk[UART_CHUNK_LENGTH];
+	int16_t length_read;
+	int64_t start_us;
+
+	watchdog_probe_start(self);
+	start_us = esp_timer_get_time();
+
+	while (esp_timer_get_time() - start_us < WATCHDOG_PROBE_US){
+		length_read = uart_read_bytes(self->uart_number, chunk, UART_CHUNK_LENGTH, pdMS_TO_TICKS(20));
+		self->chunk_received_us = esp_timer_get_time();
+
+		if (length_read > 0){
+			frame_bytes(self, chunk, length_read);
+		}
+
+		if (self->watchdog.frame_count != frame_count){
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static void watchdog_recover(neo_m8_obj_t* self, uint8_t reason){
+	/**
+	 * Starts an attempt to get the module talking again, which watchdog_step() then takes a step further with each read, so no read
+	 * blocks for it: the module is looked for at each common baud rate in turn (the current one first), then the cached configuration,
+	 * which the module loses if it has reset, is re-sent. Every attempt is logged for health()
+	*/
+	watchdog_t* watchdog = &(self->watchdog);
+	watchdog_event_t* event = &(watchdog->events[watchdog->event_head]);
+
+	event->time_us = esp_timer_get_time();
+	event->reason = reason;
+	event->baud_rate = 0;
+	event->replayed = 0;
+
+	uart_get_baudrate(self->uart_number, &(watchdog->original_baud_rate));
+	watchdog->state = WATCHDOG_PROBING;
+	watchdog->probe_index = 0;
+	watchdog_probe_start(self);
+	watchdog->probe_frame_count = watchdog->frame_count;
+	watchdog->step_us = esp_timer_get_time();
+}
+
+static void watchdog_step(neo_m8_obj_t* self){
+	/**
+	 * Takes the recovery attempt in hand a step further, run at the end of every read while there is one
+	 * Probing, the module is found once a valid sentence/frame arrives - if none has after WATCHDOG_PROBE_US, the next baud rate is tried
+	 * Replaying, each cached configuration message is sent once the previous one's ACK has arrived, or WATCHDOG_REPLAY_ACK_US has passed
+	*/
+	watchdog_t* watchdog = &(self->watchdog);
+	watchdog_event_t* event = &(watchdog->events[watchdog->event_head]);
+	config_packet_t* cached;
+	int64_t now_us = esp_timer_get_time();
+
+	if (watchdog->state == WATCHDOG_PROBING){
+		if (watchdog->frame_count != watchdog->probe_frame_count){
+			uart_get_baudrate(self->uart_number, &(event->baud_rate));
+			watchdog->state = WATCHDOG_REPLAYING;
+			watchdog->replay_index = 0;
+			watchdog->replay_ack.waiting = 0;
+		}
+		else if (now_us - watchdog->step_us < WATCHDOG_PROBE_US){
+			return;
+		}
+		else {
+			// Moving on to the next baud rate - the original one was tried first, so it's skipped
+			do {
+				watchdog->probe_index++;
+			} while ((watchdog->probe_index <= BAUD_RATE_COUNT) && (baud_rates[watchdog->probe_index - 1] == watchdog->original_baud_rate));
+
+			if (watchdog->probe_index > BAUD_RATE_COUNT){
+				uart_set_baudrate(self->uart_number, watchdog->original_baud_rate);
+				watchdog_finish(self);
+				return;
+			}
+
+			uart_set_baudrate(self->uart_number, baud_rates[watchdog->probe_index - 1]);
+			watchdog_probe_start(self);
+			watchdog->probe_frame_count = watchdog->frame_count;
+			watchdog->step_us = now_us;
+			return;
+		}
+	}
+
+	// The last message re-sent counts once it's ACKed, or is given up on
+	if (watchdog->replay_index > 0){
+		if (watchdog->replay_ack.waiting && (now_us - watchdog->replay_ack.sent_us < WATCHDOG_REPLAY_ACK_US)){
+			return;
+		}
+
+		watchdog->replay_ack.waiting = 0;
+		if (watchdog->replay_ack.result == 1){
+			event->replayed++;
+		}
+	}
+
+	if (watchdog->replay_index >= watchdog->config_count){
+		watchdog_finish(self);
+		return;
+	}
+
+	cached = &(watchdog->config[watchdog->replay_index++]);
+	ubx_pending_start(&(watchdog->replay_ack), cached->packet[2], cached->packet[3]);
+
+	if (uart_write_bytes(self->uart_number, cached->packet, cached->length) != cached->length){
+		watchdog->replay_ack.waiting = 0;
+	}
+}
+
+static void watchdog_finish(neo_m8_obj_t* self){
+	/**
+	 * Ends the recovery attempt in hand, logging it and starting the supervisor afresh
+	*/
+	watchdog_t* watchdog = &(self->watchdog);
+
+	if (watchdog->events[watchdog->event_head].baud_rate != 0){
+		watchdog->failures = 0;
+	}
+	else if (watchdog->failures < WATCHDOG_MAX_BACKOFF){
+		watchdog->failures++;
+	}
+
+	watchdog->event_head = (watchdog->event_head + 1) % WATCHDOG_EVENT_LENGTH;
+	if (watchdog->event_count < WATCHDOG_EVENT_LENGTH){
+		watchdog->event_count++;
+	}
+	watchdog->recoveries++;
+
+	watchdog->last_byte_us = esp_timer_get_time();
+	watchdog->window_bytes = 0;
+	watchdog->window_garbage = 0;
+	watchdog->state = WATCHDOG_IDLE;
+}
+
+static void rf_poll(neo_m8_obj_t* self){
+	/**
+	 * Polls UBX-MON-HW if it's due - doesn't wait for the response, which is decoded by the framing layer whenever it arrives
+	*/
+	rf_monitor_t* rf = &(self->rf);
+	uint8_t empty[1];
+	int64_t now_us;
+
+	if (rf->poll_period_ms == 0){
+		return;
+	}
+
+	now_us = esp_timer_get_time();
+
+	if (now_us - rf->polled_us >= 1000*(int64_t)(rf->poll_period_ms)){
+		ubx_write_packet(self, 0x0A, 0x09, empty, 0);
+		rf->polled_us = now_us;
+	}
+}
+
+static void leap_seconds_poll(neo_m8_obj_t* self){
+	/**
+	 * Until the receiver has reported valid leap seconds, polls UBX-NAV-TIMEGPS every LEAP_SECONDS_POLL_US
+	 * Doesn't wait for the response, which is decoded by the framing layer whenever it arrives
+	*/
+	uint8_t empty[1];
+	int64_t now_us;
+
+	if (self->leap_seconds_valid){
+		return;
+	}
+
+	now_us = esp_timer_get_time();
+
+	if ((self->leap_seconds_polled_us == 0) || (now_us - self->leap_seconds_polled_us >= LEAP_SECONDS_POLL_US)){
+		ubx_write_packet(self, 0x01, 0x20, empty, 0);
+		self->leap_seconds_polled_us = now_us;
+	}
+}
+
+static void rf_decode(neo_m8_obj_t* self){
+	/**
+	 * Decodes a UBX-MON-HW frame into the RF status
+	 * If jammingState has just risen to warning or critical, the callback (if any) is scheduled with the driver object as its argument
+	*/
+	rf_monitor_t* rf = &(self->rf);
+	const uint8_t* payload = self->frame + 6;
+	uint8_t previous_state = rf->jamming_state;
+
+	rf->noise_per_ms = payload[16] | (payload[17] << 8);
+	rf->agc_count = payload[18] | (payload[19] << 8);
+	rf->antenna_status = payload[20];
+	rf->antenna_power = payload[21];
+	rf->jamming_state = (payload[22] >> 2) & 0x03;
+	rf->jam_indicator = payload[45];
+	rf->received_us = self->chunk_received_us;
+
+	if ((rf->jamming_state >= JAMMING_WARNING) && (rf->jamming_state > previous_state) && (rf->callback != mp_const_none)){
+		mp_sched_schedule(rf->callback, MP_OBJ_FROM_PTR(self));
+	}
+}
+
+static uint32_t read_u32(const uint8_t* data){
+	/**
+	 * Reads a little-endian 32-bit value out of a UBX payload
+	*/
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)(data[3]) << 24);
+}
+
+static void decode_nav_pvt(neo_m8_obj_t* self){
+	/**
+	 * Takes the accuracy estimates (hAcc, vAcc, sAcc, headAcc) and north/east/down velocity out of a UBX-NAV-PVT frame
+	 * Only fixes flagged gnssFixOK count towards the startup profile's accurate fix milestone
+	*/
+	const uint8_t* payload = self->frame + 6;
+	accuracy_t* accuracy = &(self->accuracy);
+	int32_t time_of_day_ms = itow_time_of_day(self, read_u32(payload));
+
+	accuracy->horizontal_mm = read_u32(payload + 40);
+	accuracy->vertical_mm = read_u32(payload + 44);
+	accuracy->source = ACCURACY_SOURCE_NAV_PVT;
+	accuracy->received_us = self->chunk_received_us;
+	accuracy->time_of_day_ms = time_of_day_ms;
+
+	accuracy->speed_mms = read_u32(payload + 68);
+	accuracy->heading_e5 = read_u32(payload + 72);
+	accuracy->velocity_received_us = self->chunk_received_us;
+	accuracy->velocity_time_of_day_ms = time_of_day_ms;
+
+	// NAV-PVT velocities and sAcc are in mm/s
+	self->data.velocity_north_cms = (int32_t)(read_u32(payload + 48)) / 10;
+	self->data.velocity_east_cms = (int32_t)(read_u32(payload + 52)) / 10;
+	self->data.velocity_down_cms = (int32_t)(read_u32(payload + 56)) / 10;
+	self->data.speed_accuracy_cms = accuracy->speed_mms / 10;
+	self->data.velocity_source = VELOCITY_SOURCE_NAV_PVT;
+	self->data.velocity_received_us = self->chunk_received_us;
+	self->data.velocity_time_of_day_ms = time_of_day_ms;
+
+	if (payload[21] & 0x01){
+		profile_accuracy(self, accuracy->horizontal_mm, self->chunk_received_us);
+	}
+}
+
+static void decode_nav_posllh(neo_m8_obj_t* self){
+	/**
+	 * Takes the accuracy estimates (hAcc, vAcc) out of a UBX-NAV-POSLLH frame
+	 * NAV-POSLLH has no fix status, so it doesn't count towards the startup profile
+	*/
+	const uint8_t* payload = self->frame + 6;
+
+	self->accuracy.horizontal_mm = read_u32(payload + 20);
+	self->accuracy.vertical_mm = read_u32(payload + 24);
+	self->accuracy.source = ACCURACY_SOURCE_NAV_POSLLH;
+	self->accuracy.received_us = self->chunk_received_us;
+	self->accuracy.time_of_day_ms = itow_time_of_day(self, read_u32(payload));
+}
+
+static void decode_pubx_accuracy(neo_m8_obj_t* self){
+	/**
+	 * Takes the accuracy estimates (hAcc, vAcc, in m) out of a PUBX,00 sentence, unless its navigation status is "NF" (no fix)
+	*/
+	char* sentence = (char*)(self->frame);
+	char* status = nmea_field(sentence, self->frame_length, 8);
+	char* horizontal = nmea_field(sentence, self->frame_length, 9);
+	char* vertical = nmea_field(sentence, self->frame_length, 10);
+
+	if ((status == NULL) || (vertical == NULL) || (strncmp(status, "NF", 2) == 0) || (*horizontal == ',') || (*vertical == ',')){
+		return;
+	}
+
+	self->accuracy.horizontal_mm = strtof(horizontal, NULL) * 1000;
+	self->accuracy.vertical_mm = strtof(vertical, NULL) * 1000;
+	self->accuracy.source = ACCURACY_SOURCE_PUBX;
+	self->accuracy.received_us = self->chunk_received_us;
+	self->accuracy.time_of_day_ms = extract_time_of_day(sentence + 9);
+
+	profile_accuracy(self, self->accuracy.horizontal_mm, self->chunk_received_us);
+}
+
+static void decode_nav_velned(neo_m8_obj_t* self){
+	/**
+	 * Takes the north/east/down velocity and speed/heading accuracy estimates (sAcc, cAcc) out of a UBX-NAV-VELNED frame
+	*/
+	const uint8_t* payload = self->frame + 6;
+	int32_t time_of_day_ms = itow_time_of_day(self, read_u32(payload));
+
+	self->data.velocity_north_cms = read_u32(payload + 4);
+	self->data.velocity_east_cms = read_u32(payload + 8);
+	self->data.velocity_down_cms = read_u32(payload + 12);
+	self->data.speed_accuracy_cms = read_u32(payload + 28);
+	self->data.velocity_source = VELOCITY_SOURCE_NAV_VELNED;
+	self->data.velocity_received_us = self->chunk_received_us;
+	self->data.velocity_time_of_day_ms = time_of_day_ms;
+
+	self->accuracy.speed_mms = 10*read_u32(payload + 28);
+	self->accuracy.heading_e5 = read_u32(payload + 32);
+	self->accuracy.velocity_received_us = self->chunk_received_us;
+	self->accuracy.velocity_time_of_day_ms = time_of_day_ms;
+}
+
+static uint8_t velocity_ned_fix(neo_m8_obj_t* self, int32_t time_of_day_ms){
+	/**
+	 * Replaces the SOG/COG velocity of a fix (at the given UTC time of day) with the receiver's north/east/down velocity if there's one
+	 * from the same epoch - it's more precise, and still valid at low speeds where COG isn't
+	 * Returns 1 if it was replaced, 0 if not
+	*/
+	if ((self->data.velocity_source == VELOCITY_SOURCE_NONE) || (self->data.velocity_source == VELOCITY_SOURCE_PUBX)
+	    || !accuracy_fresh(self->data.velocity_time_of_day_ms, time_of_day_ms)){
+		return 0;
+	}
+
+	self->data.velocity_north_mms = 10*self->data.velocity_north_cms;
+	self->data.velocity_east_mms = 10*self->data.velocity_east_cms;
+	self->data.velocity_down_mms = 10*self->data.velocity_down_cms;
+
+	return 1;
+}
+
+static uint8_t accuracy_fresh(int32_t estimate_time_of_day_ms, int32_t fix_time_of_day_ms){
+	/**
+	 * Checks whether an accuracy estimate/velocity is from the same navigation epoch as the fix being parsed, by their UTC times of day,
+	 * so it can be used for that fix - an estimate from any other epoch, however recent, isn't
+	*/
+	int32_t difference_ms;
+
+	if ((estimate_time_of_day_ms < 0) || (fix_time_of_day_ms < 0)){
+		return 0;
+	}
+
+	// Allowing for the two being either side of midnight
+	difference_ms = abs(estimate_time_of_day_ms - fix_time_of_day_ms);
+
+	return (difference_ms <= ACCURACY_EPOCH_TOLERANCE_MS) || (difference_ms >= 86400000 - ACCURACY_EPOCH_TOLERANCE_MS);
+}
+
+static int32_t itow_time_of_day(neo_m8_obj_t* self, uint32_t itow_ms){
+	/**
+	 * Converts a UBX-NAV iTOW (GPS time of week, ms) to the UTC time of day (ms) it's for, with the receiver's leap seconds (or the fallback)
+	*/
+	return (int32_t)(((int64_t)itow_ms - 1000*(int64_t)(self->leap_seconds)) % 86400000 + 86400000) % 86400000;
+}
+
+static int8_t ubx_file_read_frame(mp_obj_t file, uint8_t* frame, uint16_t* length){
+	/**
+	 * Reads the next UBX frame from a file of back-to-back frames (as saved by save_navdb() or downloaded from AssistNow)
+	 * Returns 1 if all good, 0 at the end of the file, -1 if the file is corrupt
+	*/
+	int error = 0;
+	mp_uint_t bytes_read;
+	uint8_t ck_a, ck_b;
+
+	bytes_read = mp_stream_rw(file, frame, 6, &error, MP_STREAM_RW_READ);
+
+	if ((bytes_read == 0) && (error == 0)){
+		return 0;
+	}
+	if ((bytes_read != 6) || (frame[0] != 0xB5) || (frame[1] != 0x62)){
+		return -1;
+	}
+
+	*length = (frame[4] | (frame[5] << 8)) + 8;
+
+	if (*length > UBX_MAX_PAYLOAD_LENGTH + 8){
+		return -1;
+	}
+	if (mp_stream_rw(file, frame + 6, *length - 6, &error, MP_STREAM_RW_READ) != *length - 6){
+		return -1;
+	}
+
+	ubx_checksum(frame + 2, *length - 4, &ck_a, &ck_b);
+
+	if ((ck_a != frame[*length - 2]) || (ck_b != frame[*length - 1])){
+		return -1;
+	}
+
+	return 1;
+}
+
+static int8_t mga_send_acked(neo_m8_obj_t* self, const uint8_t* frame, uint16_t length, uint8_t acked){
+	/**
+	 * Sends a complete UBX-MGA frame, then waits for the UBX-MGA-ACK-DATA0 for it before anything else is sent
+	 * Needs ackAiding turned on in UBX-CFG-NAVX5 - if mga_enable_ack() couldn't turn it on (acked is 0), there's nothing to wait for,
+	 * so the frame is just followed by a fixed MGA_UNACKED_PACING_US pause
+	 * Returns 1 if the module accepted it, 0 if it rejected it and -1 if no acknowledgement arrived
+	*/
+	uint64_t start_time;
+	uint8_t sequence = self->mga_ack_sequence;
+
+	if (uart_write_bytes(self->uart_number, frame, length) != length){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	}
+
+	start_time = esp_timer_get_time();
+
+	if (!acked){
+		while (esp_timer_get_time() - start_time < MGA_UNACKED_PACING_US){
+			update_buffer_internal(self);
+		}
+		return -1;
+	}
+
+	while (esp_timer_get_time() - start_time < MGA_ACK_TIMEOUT_US){
+		update_buffer_internal(self);
+
+		// Checking the acknowledgement is for this message - MGA-ACK echoes its ID and first 4 payload bytes
+		if ((self->mga_ack_sequence != sequence) && (self->mga_ack_msg_id == frame[3]) &&
+		    ((length < 14) || (memcmp(self->mga_ack_payload_start, frame + 6, 4) == 0))){
+			return (self->mga_ack_type == 1) ? 1 : 0;
+		}
+	}
+
+	return -1;
+}
+
+static uint8_t mga_enable_ack(neo_m8_obj_t* self){
+	/**
+	 * Turns on UBX-MGA-ACK for aiding data, which mga_send_acked() relies on for flow control
+	 * UBX-CFG-NAVX5 version 2, with only ackAiding applied (mask1 bit 10)
+	 * Returns 1 if the module ACKed it, 0 if not - then there won't be any UBX-MGA-ACKs to wait for
+	*/
+	uint8_t navx5[40] = {0};
+
+	navx5[0] = 0x02;
+	navx5[3] = 0x04;
+	navx5[17] = 0x01;
+
+	ubx_write_packet(self, 0x06, 0x23, navx5, 40);
+	return ubx_ack_nack(self, 0x06, 0x23) == 1;
+}
+
+static int32_t utc_today(neo_m8_obj_t* self){
+	/**
+	 * Works out today's UTC date (days since 1970-01-01) from the module's time, or failing that the time saved in RTC memory
+	 * Returns -1 if neither is known
+	*/
+	int64_t elapsed_us;
+
+	if ((self->time_received_us != 0) && (self->received_time.date_days > 0)){
+		return utc_now_us(self) / 86400000000LL;
+	}
+
+	if ((rtc_aiding.magic == RTC_AIDING_MAGIC) && (rtc_aiding.fix_utc_us >= 86400000000LL)){
+		elapsed_us = system_time_us() - rtc_aiding.system_us;
+
+		if (elapsed_us >= 0){
+			return (rtc_aiding.fix_utc_us + elapsed_us) / 86400000000LL;
+		}
+	}
+
+	return -1;
+}
+
+static void profile_start(neo_m8_obj_t* self, int64_t start_us, uint8_t in_histogram){
+	/**
+	 * Starts timing a new startup (esp_timer time), clearing every milestone
+	 * Only a real start of the receiver (in_histogram) adds its time to first 3D fix to the histogram
+	*/
+	uint8_t i;
+
+	self->profile.start_us = start_us;
+	self->profile.in_histogram = in_histogram;
+
+	for (i = 0; i < MILESTONE_COUNT; i++){
+		self->profile.milestone_us[i] = -1;
+	}
+}
+
+static void profile_milestone(neo_m8_obj_t* self, milestone_t milestone, int64_t time_us){
+	/**
+	 * Notes when a startup milestone was reached (esp_timer time), if it hasn't been already
+	 * Reaching a 3D fix also adds the time taken to the histogram in RTC memory
+	*/
+	uint8_t bin;
+
+	if (self->profile.milestone_us[milestone] != -1){
+		return;
+	}
+
+	self->profile.milestone_us[milestone] = time_us - self->profile.start_us;
+
+	if ((milestone == MILESTONE_FIX_3D) && self->profile.in_histogram){
+		if (rtc_profile.magic != RTC_PROFILE_MAGIC){
+			memset(&rtc_profile, 0, sizeof(rtc_profile_t));
+			rtc_profile.magic = RTC_PROFILE_MAGIC;
+		}
+
+		for (bin = 0; (bin < PROFILE_HISTOGRAM_BINS - 1) && (self->profile.milestone_us[milestone] > profile_histogram_limits[bin]*1000000LL); bin++);
+
+		if (rtc_profile.counts[bin] < UINT16_MAX){
+			rtc_profile.counts[bin]++;
+		}
+	}
+}
+
+static void profile_accuracy(neo_m8_obj_t* self, int32_t accuracy_mm, int64_t time_us){
+	/**
+	 * Notes the first fix with a horizontal accuracy estimate within the profile's threshold
+	*/
+	if ((accuracy_mm > 0) && (accuracy_mm <= self->profile.accuracy_threshold_mm)){
+		profile_milestone(self, MILESTONE_FIX_ACCURATE, time_us);
+	}
+}
+
+static void profile_fix(neo_m8_obj_t* self){
+	/**
+	 * Checks the sentence in the frame for startup milestones - GSA or PUBX,00 for the fix type (2D/3D),
+	 * GGA for a fix with its HDOP-based accuracy estimate (HDOP x 2.5m) - only while the receiver's own estimate from UBX-NAV-PVT
+	 * or PUBX,00 (handled by decode_nav_pvt()/decode_pubx_accuracy()) hasn't been seen
+	*/
+	char* sentence = (char*)(self->frame);
+	char* field;
+
+	if (strncmp(sentence + 3, "GSA,", 4) == 0){
+		field = nmea_field(sentence, self->frame_length, 2);
+
+		if ((field != NULL) && ((*field == '2') || (*field == '3'))){
+			profile_milestone(self, MILESTONE_FIX_2D, self->chunk_received_us);
+		}
+		if ((field != NULL) && (*field == '3')){
+			profile_milestone(self, MILESTONE_FIX_3D, self->chunk_received_us);
+		}
+	}
+	else if (strncmp(sentence + 1, "PUBX,00,", 8) == 0){
+		field = nmea_field(sentence, self->frame_length, 8);
+
+		if ((field != NULL) && ((field[0] == 'G') || (field[0] == 'D')) && ((field[1] == '2') || (field[1] == '3'))){
+			profile_milestone(self, MILESTONE_FIX_2D, self->chunk_received_us);
+		}
+		if ((field != NULL) && ((field[0] == 'G') || (field[0] == 'D')) && (field[1] == '3')){
+			profile_milestone(self, MILESTONE_FIX_3D, self->chunk_received_us);
+		}
+	}
+	else if (strncmp(sentence + 3, "GGA,", 4) == 0){
+		field = nmea_field(sentence, self->frame_length, 6);
+
+		if ((field == NULL) || (*field < '1') || (*field > '9') ||
+		    (self->accuracy.source == ACCURACY_SOURCE_NAV_PVT) || (self->accuracy.source == ACCURACY_SOURCE_PUBX)){
+			return;
+		}
+
+		field = nmea_field(sentence, self->frame_length, 8);
+
+		if ((field != NULL) && (*field != ',')){
+			profile_accuracy(self, strtof(field, NULL) * HDOP_TO_ERROR_MM, self->chunk_received_us);
+		}
+	}
+}
+
+static int64_t system_time_us(void){
+	/**
+	 * Returns the ESP32's system time in microseconds - unlike esp_timer, this keeps counting through deep sleep and resets
+	*/
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+
+	return (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static void rtc_save_fix(neo_m8_obj_t* self){
+	/**
+	 * Saves the latest fix to RTC memory for aiding the next startup, and logs this boot's time to first fix if it's the first
+	*/
+	if (rtc_aiding.magic != RTC_AIDING_MAGIC){
+		memset(&rtc_aiding, 0, sizeof(rtc_aiding_t));
+		rtc_aiding.magic = RTC_AIDING_MAGIC;
+	}
+
+	rtc_aiding.latitude_e7 = self->data.latitude_e7;
+	rtc_aiding.longitude_e7 = self->data.longitude_e7;
+	rtc_aiding.altitude_mm = self->data.altitude_mm;
+	rtc_aiding.position_error_mm = self->data.position_error_mm;
+	rtc_aiding.fix_utc_us = self->data.fix_utc_us;
+	rtc_aiding.system_us = system_time_us();
+
+	// Time to first fix is measured from the ESP32 booting, when esp_timer starts - so it's only logged by the first driver since then
+	if (!self->first_fix_logged){
+		rtc_aiding.ttff_ms[(rtc_aiding.ttff_head + rtc_aiding.ttff_count) % RTC_TTFF_LOG_LENGTH] = self->chunk_received_us / 1000;
+		rtc_aiding.ttff_aided[(rtc_aiding.ttff_head + rtc_aiding.ttff_count) % RTC_TTFF_LOG_LENGTH] = self->aided;
+
+		if (rtc_aiding.ttff_count < RTC_TTFF_LOG_LENGTH){
+			rtc_aiding.ttff_count++;
+		}
+		else {
+			rtc_aiding.ttff_head = (rtc_aiding.ttff_head + 1) % RTC_TTFF_LOG_LENGTH;
+		}
+
+		self->first_fix_logged = 1;
+	}
+}
+
+static uint8_t rtc_aid(neo_m8_obj_t* self){
+	/**
+	 * Sends UBX-MGA-INI-TIME_UTC and UBX-MGA-INI-POS_LLH built from the fix saved in RTC memory, with accuracies
+	 * that grow with the time since it was saved - the RTC clock drifts, and the receiver may have moved
+	 * Returns which were sent - bit 0 for time, bit 1 for position
+	*/
+	uint8_t time_utc[24] = {0};
+	uint8_t position[20] = {0};
+	int64_t elapsed_us, utc_us, accuracy_us;
+	int64_t accuracy_cm;
+	int32_t days, year;
+	uint32_t time_of_day_ms, nanoseconds;
+	uint8_t month, day, sent = 0;
+
+	if ((rtc_aiding.magic != RTC_AIDING_MAGIC) || (rtc_aiding.fix_utc_us == 0)){
+		return 0;
+	}
+
+	elapsed_us = system_time_us() - rtc_aiding.system_us;
+
+	// The system clock has been set backwards since, so nothing can be trusted
+	if (elapsed_us < 0){
+		return 0;
+	}
+
+	utc_us = rtc_aiding.fix_utc_us + elapsed_us;
+	accuracy_us = AIDING_TIME_BASE_US + elapsed_us / 1000000 * AIDING_CLOCK_DRIFT_PPM;
+	days = utc_us / 86400000000LL;
+	time_of_day_ms = (utc_us / 1000) % 86400000;
+	nanoseconds = (utc_us % 1000000) * 1000;
+	civil_from_days(days, &year, &month, &day);
+
+	// UBX-MGA-INI-TIME_UTC - time reference is on receipt of the message
+	// Leap seconds are flagged as unknown (-128) unless the receiver has reported them, so it uses its own rather than a guess
+	time_utc[0] = 0x10;
+	time_utc[3] = self->leap_seconds_valid ? (uint8_t)(self->leap_seconds) : 0x80;
+	time_utc[4] = year & 0xFF;
+	time_utc[5] = year >> 8;
+	time_utc[6] = month;
+	time_utc[7] = day;
+	time_utc[8] = time_of_day_ms / 3600000;
+	time_utc[9] = (time_of_day_ms / 60000) % 60;
+	time_utc[10] = (time_of_day_ms / 1000) % 60;
+	time_utc[12] = nanoseconds & 0xFF;
+	time_utc[13] = (nanoseconds >> 8) & 0xFF;
+	time_utc[14] = (nanoseconds >> 16) & 0xFF;
+	time_utc[15] = nanoseconds >> 24;
+	time_utc[16] = (accuracy_us / 1000000) & 0xFF;
+	time_utc[17] = ((accuracy_us / 1000000) >> 8) & 0xFF;
+	time_utc[20] = ((accuracy_us % 1000000) * 1000) & 0xFF;
+	time_utc[21] = (((accuracy_us % 1000000) * 1000) >> 8) & 0xFF;
+	time_utc[22] = (((accuracy_us % 1000000) * 1000) >> 16) & 0xFF;
+	time_utc[23] = ((accuracy_us % 1000000) * 1000) >> 24;
+
+	ubx_write_packet(self, 0x13, 0x40, time_utc, 24);
+	sent |= 1;
+
+	// UBX-MGA-INI-POS_LLH - only if the receiver can't have gone too far since
+	accuracy_cm = (rtc_aiding.position_error_mm + elapsed_us / 1000000 * AIDING_SPEED_MMS) / 10;
+
+	if (accuracy_cm * 10 <= AIDING_MAX_POSITION_ERROR_MM){
+		position[0] = 0x01;
+		memcpy(position + 4, &(rtc_aiding.latitude_e7), 4);
+		memcpy(position + 8, &(rtc_aiding.longitude_e7), 4);
+		position[12] = (rtc_aiding.altitude_mm / 10) & 0xFF;
+		position[13] = ((rtc_aiding.altitude_mm / 10) >> 8) & 0xFF;
+		position[14] = ((rtc_aiding.altitude_mm / 10) >> 16) & 0xFF;
+		position[15] = (rtc_aiding.altitude_mm / 10) >> 24;
+		position[16] = accuracy_cm & 0xFF;
+		position[17] = (accuracy_cm >> 8) & 0xFF;
+		position[18] = (accuracy_cm >> 16) & 0xFF;
+		position[19] = accuracy_cm >> 24;
+
+		ubx_write_packet(self, 0x13, 0x40, position, 20);
+		sent |= 2;
+	}
+
+	return sent;
+}
+
+static void update_fix_snapshot(neo_m8_obj_t* self){
+	/**
+	 * Updates the fixed-point copy of the latest fix, and the values precomputed from it for extrapolation
+	*/
+	self->data.altitude_mm = self->data.altitude * 1000;
+	self->data.position_error_mm = self->data.position_error * 1000;
+	self->data.fix_utc_us = self->data.time.utc_us;
+
+	// Millimetres per degree of longitude shrink with cos(latitude) - clamped so it can't reach 0 at the poles
+	self->data.lon_mm_per_degree = MM_PER_DEGREE * cosf(self->data.latitude * DEG_TO_RAD);
+
+	if (self->data.lon_mm_per_degree < 1000){
+		self->data.lon_mm_per_degree = 1000;
+	}
+}
+
+static void process_fix(neo_m8_obj_t* self){
+	/**
+	 * Runs everything that consumes a new position fix
+	 * The track log goes last, as a failed flash write raises - everything else has still had the fix by then
+	*/
+	uint8_t new_fix;
+
+	update_fix_snapshot(self);
+
+	if (self->enu.enabled){
+		enu_update(self);
+	}
+
+	// Only fixes newer than the last one are logged or checked against geofences
+	new_fix = (history_push(self) == 1);
+
+	if (new_fix){
+		rtc_save_fix(self);
+
+		if (self->geofences.count > 0){
+			geofence_fix(self);
+		}
+	}
+
+	if (self->kalman.enabled){
+		kalman_position_fix(self);
+	}
+
+	if (self->rate.adaptive){
+		rate_adapt(self);
+	}
+
+	if (new_fix && (self->track.file != MP_OBJ_NULL)){
+		track_log_fix(self, history_record(&(self->history), self->history.count - 1));
+	}
+}
+
+static uint8_t history_push(neo_m8_obj_t* self){
+	/**
+	 * Adds the latest fix to the history ring, overwriting the oldest once it's full
+	 * Fixes that aren't newer than the last one are skipped, so the ring is always in time order
+	 * Returns 1 if the fix was added, 0 if it was skipped
+	*/
+	fix_history_t* history = &(self->history);
+	fix_record_t* record;
+
+	if ((history->count > 0) && (self->data.fix_utc_us <= history_record(history, history->count - 1)->utc_us)){
+		return 0;
+	}
+
+	record = &(history->records[history->head]);
+	record->utc_us = self->data.fix_utc_us;
+	record->latitude_e7 = self->data.latitude_e7;
+	record->longitude_e7 = self->data.longitude_e7;
+	record->altitude_mm = self->data.altitude_mm;
+	record->speed_cms = (self->data.sog * KNOTS_TO_MMS / 10 > 65535) ? 65535 : self->data.sog * KNOTS_TO_MMS / 10;
+
+	history->head = (history->head + 1) % FIX_HISTORY_LENGTH;
+
+	if (history->count < FIX_HISTORY_LENGTH){
+		history->count++;
+	}
+
+	return 1;
+}
+
+static fix_record_t* history_record(fix_history_t* history, uint16_t index){
+	/**
+	 * Returns a record from the history ring by age order - index 0 is the oldest
+	*/
+	return &(history->records[(history->head + FIX_HISTORY_LENGTH - history->count + index) % FIX_HISTORY_LENGTH]);
+}
+
+static int8_t history_lookup(fix_history_t* history, int64_t utc_us, int32_t* output){
+	/**
+	 * Finds where the receiver was at a UTC time, by binary searching the history ring and linearly interpolating between the fixes either side
+	 * Output is [latitude (1e-7 degrees), longitude (1e-7 degrees), altitude (mm), speed (cm/s)]
+	 * Returns 1 if all good, 0 if the time is outside the history
+	*/
+	fix_record_t *before, *after;
+	uint16_t low = 0, high, middle;
+	int64_t span, offset, longitude_difference, longitude;
+
+	if ((history->count == 0) || (utc_us < history_record(history, 0)->utc_us) || (utc_us > history_record(history, history->count - 1)->utc_us)){
+		return 0;
+	}
+
+	// Finding the first fix at or after the time
+	high = history->count - 1;
+
+	while (low < high){
+		middle = (low + high) / 2;
+
+		if (history_record(history, middle)->utc_us < utc_us){
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	after = history_record(history, low);
+	before = (low == 0) ? after : history_record(history, low - 1);
+
+	span = after->utc_us - before->utc_us;
+	offset = utc_us - before->utc_us;
+
+	if (span == 0){
+		span = 1;
+		offset = 1;
+	}
+
+	// Taking the short way round the antimeridian, then wrapping the result back into +/-180 degrees
+	longitude_difference = (int64_t)(after->longitude_e7) - before->longitude_e7;
+
+	if (longitude_difference > 1800000000LL){
+		longitude_difference -= 3600000000LL;
+	}
+	else if (longitude_difference < -1800000000LL){
+		longitude_difference += 3600000000LL;
+	}
+
+	longitude = before->longitude_e7 + longitude_difference * offset / span;
+
+	if (longitude > 1800000000LL){
+		longitude -= 3600000000LL;
+	}
+	else if (longitude < -1800000000LL){
+		longitude += 3600000000LL;
+	}
+
+	output[0] = before->latitude_e7 + ((int64_t)(after->latitude_e7) - before->latitude_e7) * offset / span;
+	output[1] = longitude;
+	output[2] = before->altitude_mm + ((int64_t)(after->altitude_mm) - before->altitude_mm) * offset / span;
+	output[3] = before->speed_cms + ((int64_t)(after->speed_cms) - before->speed_cms) * offset / span;
+
+	return 1;
+}
+
+static void track_log_fix(neo_m8_obj_t* self, const fix_record_t* record){
+	/**
+	 * Appends a fix to the current track log block, writing the block out to the file once the fix won't fit
+	 * Every block starts with a keyframe, so the file can be decoded from any block boundary
+	*/
+	track_log_t* track = &(self->track);
+
+	if (!track_append(&(track->encoder), record, track->block, &(track->block_length))){
+		track_write_block(self);
+		track_append(&(track->encoder), record, track->block, &(track->block_length));
+	}
+
+	track->fix_count++;
+}
+
+static void track_write_block(neo_m8_obj_t* self){
+	/**
+	 * Pads the current track log block out with TRACK_TAG_PADDING and writes it to the file in one go
+	 * If the write fails, logging is stopped and an OSError raised
+	*/
+	track_log_t* track = &(self->track);
+	int error = 0;
+
+	track_pad_block(track->block, track->block_length);
+
+	if (mp_stream_rw(track->file, track->block, TRACK_BLOCK_LENGTH, &error, MP_STREAM_RW_WRITE) != TRACK_BLOCK_LENGTH){
+		track_close(self);
+		mp_raise_OSError((error != 0) ? error : MP_EIO);
+	}
+
+	track->bytes_written += TRACK_BLOCK_LENGTH;
+	track->block_length = 0;
+}
+
+static void track_close(neo_m8_obj_t* self){
+	/**
+	 * Closes the track log file and frees its block, without writing anything
+	*/
+	track_log_t* track = &(self->track);
+
+	if (track->file != MP_OBJ_NULL){
+		mp_stream_close(track->file);
+		track->file = MP_OBJ_NULL;
+	}
+
+	if (track->block != NULL){
+		m_del(uint8_t, track->block, TRACK_BLOCK_LENGTH);
+		track->block = NULL;
+	}
+}
+
+static void geofence_fix(neo_m8_obj_t* self){
+	/**
+	 * Checks the latest fix against every geofence, queueing an event for each one entered or exited
+	*/
+	geofence_set_t* set = &(self->geofences);
+	geofence_polygon_t* polygon;
+	geofence_event_t* event;
+	int32_t x, y;
+	uint8_t in_range, inside;
+	uint16_t i;
+
+	in_range = geofence_project(set, self->data.latitude_e7, self->data.longitude_e7, &x, &y);
+
+	for (i = 0; i < set->count; i++){
+		polygon = &(set->polygons[i]);
+		inside = in_range ? geofence_contains(set, polygon, x, y) : 0;
+
+		if (inside == polygon->inside){
+			continue;
+		}
+		polygon->inside = inside;
+
+		event = &(set->events[(set->event_head + set->event_count) % GEOFENCE_EVENT_LENGTH]);
+		event->id = polygon->id;
+		event->entered = inside;
+
+		if (set->event_count < GEOFENCE_EVENT_LENGTH){
+			set->event_count++;
+		}
+		else {
+			set->event_head = (set->event_head + 1) % GEOFENCE_EVENT_LENGTH;
+		}
+	}
+}
+
+static void haversine_float(float latitude, float longitude, const float* latitudes, const float* longitudes, float* output, size_t count){
+	/**
+	 * Great-circle distance (m) from one point to many, all in degrees
+	 * The loop body has no branches, so the compiler is free to vectorise it
+	*/
+	float cos_latitude = cosf(latitude * DEG_TO_RAD);
+	float sin_half_latitude, sin_half_longitude, a;
+	size_t i;
+
+	for (i = 0; i < count; i++){
+		sin_half_latitude = sinf((latitudes[i] - latitude) * (DEG_TO_RAD / 2));
+		sin_half_longitude = sinf((longitudes[i] - longitude) * (DEG_TO_RAD / 2));
+		a = sin_half_latitude*sin_half_latitude + cos_latitude * cosf(latitudes[i] * DEG_TO_RAD) * sin_half_longitude*sin_half_longitude;
+		output[i] = (float)(2 * EARTH_RADIUS_M) * asinf(sqrtf(fminf(a, 1.0f)));
+	}
+}
+
+static void haversine_double(double latitude, double longitude, const double* latitudes, const double* longitudes, double* output, size_t count){
+	/**
+	 * Double precision version of haversine_float()
+	*/
+	double cos_latitude = cos(latitude * DEG_TO_RAD_DOUBLE);
+	double sin_half_latitude, sin_half_longitude, a;
+	size_t i;
+
+	for (i = 0; i < count; i++){
+		sin_half_latitude = sin((latitudes[i] - latitude) * (DEG_TO_RAD_DOUBLE / 2));
+		sin_half_longitude = sin((longitudes[i] - longitude) * (DEG_TO_RAD_DOUBLE / 2));
+		a = sin_half_latitude*sin_half_latitude + cos_latitude * cos(latitudes[i] * DEG_TO_RAD_DOUBLE) * sin_half_longitude*sin_half_longitude;
+		output[i] = 2 * EARTH_RADIUS_M * asin(sqrt(fmin(a, 1.0)));
+	}
+}
+
+static void bearing_float(float latitude, float longitude, const float* latitudes, const float* longitudes, float* output, size_t count){
+	/**
+	 * Initial great-circle bearing (degrees clockwise from north, 0-360) from one point to many, all in degrees
+	*/
+	float sin_latitude = sinf(latitude * DEG_TO_RAD);
+	float cos_latitude = cosf(latitude * DEG_TO_RAD);
+	float longitude_difference, target_latitude, bearing;
+	size_t i;
+
+	for (i = 0; i < count; i++){
+		longitude_difference = (longitudes[i] - longitude) * DEG_TO_RAD;
+		target_latitude = latitudes[i] * DEG_TO_RAD;
+		bearing = atan2f(sinf(longitude_difference) * cosf(target_latitude),
+		                 cos_latitude * sinf(target_latitude) - sin_latitude * cosf(target_latitude) * cosf(longitude_difference));
+		output[i] = fmodf(bearing / DEG_TO_RAD + 360.0f, 360.0f);
+	}
+}
+
+static void bearing_double(double latitude, double longitude, const double* latitudes, const double* longitudes, double* output, size_t count){
+	/**
+	 * Double precision version of bearing_float()
+	*/
+	double sin_latitude = sin(latitude * DEG_TO_RAD_DOUBLE);
+	double cos_latitude = cos(latitude * DEG_TO_RAD_DOUBLE);
+	double longitude_difference, target_latitude, bearing;
+	size_t i;
+
+	for (i = 0; i < count; i++){
+		longitude_difference = (longitudes[i] - longitude) * DEG_TO_RAD_DOUBLE;
+		target_latitude = latitudes[i] * DEG_TO_RAD_DOUBLE;
+		bearing = atan2(sin(longitude_difference) * cos(target_latitude),
+		                cos_latitude * sin(target_latitude) - sin_latitude * cos(target_latitude) * cos(longitude_difference));
+		output[i] = fmod(bearing / DEG_TO_RAD_DOUBLE + 360.0, 360.0);
+	}
+}
+
+static double vincenty_distance(double latitude_1, double longitude_1, double latitude_2, double longitude_2){
+	/**
+	 * Distance (m) between two points (degrees) on the WGS84 ellipsoid, using Vincenty's inverse formula - accurate to well under a millimetre
+	 * Returns -1 if it doesn't converge (only for nearly antipodal points)
+	*/
+	double b = WGS84_A * (1 - WGS84_F);
+	double longitude_difference = (longitude_2 - longitude_1) * DEG_TO_RAD_DOUBLE;
+	double reduced_1 = atan((1 - WGS84_F) * tan(latitude_1 * DEG_TO_RAD_DOUBLE));
+	double reduced_2 = atan((1 - WGS84_F) * tan(latitude_2 * DEG_TO_RAD_DOUBLE));
+	double sin_u1 = sin(reduced_1), cos_u1 = cos(reduced_1);
+	double sin_u2 = sin(reduced_2), cos_u2 = cos(reduced_2);
+	double lambda = longitude_difference, previous_lambda;
+	double sin_lambda, cos_lambda, sin_sigma, cos_sigma, sigma, sin_alpha, cos_squared_alpha, cos_2_sigma_m, c;
+	double u_squared, big_a, big_b, delta_sigma;
+	uint8_t iteration;
+
+	for (iteration = 0; iteration < VINCENTY_MAX_ITERATIONS; iteration++){
+		sin_lambda = sin(lambda);
+		cos_lambda = cos(lambda);
+		sin_sigma = sqrt((cos_u2*sin_lambda) * (cos_u2*sin_lambda) +
+		                 (cos_u1*sin_u2 - sin_u1*cos_u2*cos_lambda) * (cos_u1*sin_u2 - sin_u1*cos_u2*cos_lambda));
+
+		// Coincident points
+		if (sin_sigma == 0){
+			return 0;
+		}
+
+		cos_sigma = sin_u1*sin_u2 + cos_u1*cos_u2*cos_lambda;
+		sigma = atan2(sin_sigma, cos_sigma);
+		sin_alpha = cos_u1 * cos_u2 * sin_lambda / sin_sigma;
+		cos_squared_alpha = 1 - sin_alpha*sin_alpha;
+
+		// Both points on the equator
+		cos_2_sigma_m = (cos_squared_alpha != 0) ? cos_sigma - 2*sin_u1*sin_u2/cos_squared_alpha : 0;
+
+		c = WGS84_F / 16 * cos_squared_alpha * (4 + WGS84_F * (4 - 3*cos_squared_alpha));
+		previous_lambda = lambda;
+		lambda = longitude_difference + (1 - c) * WGS84_F * sin_alpha *
+		         (sigma + c * sin_sigma * (cos_2_sigma_m + c * cos_sigma * (-1 + 2*cos_2_sigma_m*cos_2_sigma_m)));
+
+		if (fabs(lambda - previous_lambda) < 1e-12){
+			break;
+		}
+	}
+
+	if (iteration == VINCENTY_MAX_ITERATIONS){
+		return -1;
+	}
+
+	u_squared = cos_squared_alpha * (WGS84_A*WGS84_A - b*b) / (b*b);
+	big_a = 1 + u_squared / 16384 * (4096 + u_squared * (-768 + u_squared * (320 - 175*u_squared)));
+	big_b = u_squared / 1024 * (256 + u_squared * (-128 + u_squared * (74 - 47*u_squared)));
+	delta_sigma = big_b * sin_sigma * (cos_2_sigma_m + big_b / 4 * (cos_sigma * (-1 + 2*cos_2_sigma_m*cos_2_sigma_m) -
+	              big_b / 6 * cos_2_sigma_m * (-3 + 4*sin_sigma*sin_sigma) * (-3 + 4*cos_2_sigma_m*cos_2_sigma_m)));
+
+	return b * big_a * (sigma - delta_sigma);
+}
+
+static size_t batch_buffers(const mp_obj_t* args, mp_buffer_info_t* buffers){
+	/**
+	 * Gets the latitude, longitude and output buffers for the batch functions, checking they're all array('f') or all array('d')
+	 * Returns the number of points - the length of the shortest buffer
+	*/
+	size_t count, item_size, i;
+
+	mp_get_buffer_raise(args[0], &buffers[0], MP_BUFFER_READ);
+	mp_get_buffer_raise(args[1], &buffers[1], MP_BUFFER_READ);
+	mp_get_buffer_raise(args[2], &buffers[2], MP_BUFFER_WRITE);
+
+	if (((buffers[0].typecode != 'f') && (buffers[0].typecode != 'd')) ||
+	    (buffers[1].typecode != buffers[0].typecode) || (buffers[2].typecode != buffers[0].typecode)){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Buffers must all be array('f') or all array('d')"));
+	}
+
+	item_size = (buffers[0].typecode == 'f') ? sizeof(float) : sizeof(double);
+	count = buffers[0].len / item_size;
+
+	for (i = 1; i < 3; i++){
+		if (buffers[i].len / item_size < count){
+			count = buffers[i].len / item_size;
+		}
+	}
+
+	return count;
+}
+
+static void geodetic_to_ecef(double latitude, double longitude, double altitude, double* ecef){
+	/**
+	 * Converts latitude/longitude (degrees) and altitude (m, above the WGS84 ellipsoid) to earth-centred earth-fixed coordinates (m)
+	*/
+	double sin_latitude = sin(latitude * DEG_TO_RAD_DOUBLE);
+	double cos_latitude = cos(latitude * DEG_TO_RAD_DOUBLE);
+	double prime_vertical = WGS84_A / sqrt(1 - WGS84_E2 * sin_latitude*sin_latitude);
+
+	ecef[0] = (prime_vertical + altitude) * cos_latitude * cos(longitude * DEG_TO_RAD_DOUBLE);
+	ecef[1] = (prime_vertical + altitude) * cos_latitude * sin(longitude * DEG_TO_RAD_DOUBLE);
+	ecef[2] = (prime_vertical * (1 - WGS84_E2) + altitude) * sin_latitude;
+}
+
+static void enu_set_origin(enu_frame_t* frame, double latitude, double longitude, double height){
+	/**
+	 * Sets the origin of the local tangent plane - latitude/longitude in degrees, height in m above the WGS84 ellipsoid
+	 * Caches its radii of curvature and latitude terms for the series used near it, and its ECEF position and ECEF to east/north/up
+	 * rotation matrix for the exact conversion further out
+	*/
+	double sin_latitude = sin(latitude * DEG_TO_RAD_DOUBLE);
+	double cos_latitude = cos(latitude * DEG_TO_RAD_DOUBLE);
+	double sin_longitude = sin(longitude * DEG_TO_RAD_DOUBLE);
+	double cos_longitude = cos(longitude * DEG_TO_RAD_DOUBLE);
+	double w_squared = 1 - WGS84_E2 * sin_latitude*sin_latitude;
+
+	frame->origin_latitude_e7 = latitude * 1e7;
+	frame->origin_longitude_e7 = longitude * 1e7;
+	frame->origin_height_mm = height * 1000;
+	frame->sin_latitude = sin_latitude;
+	frame->cos_latitude = cos_latitude;
+	frame->meridian_radius = WGS84_A * (1 - WGS84_E2) / (w_squared * sqrt(w_squared)) + height;
+	frame->prime_vertical_radius = WGS84_A / sqrt(w_squared) + height;
+	frame->north_curvature = 1.5 * frame->meridian_radius * WGS84_E2 * sin_latitude * cos_latitude / w_squared;
+
+	geodetic_to_ecef(latitude, longitude, height, frame->origin_ecef);
+
+	frame->rotation[0][0] = -sin_longitude;
+	frame->rotation[0][1] = cos_longitude;
+	frame->rotation[0][2] = 0;
+	frame->rotation[1][0] = -sin_latitude * cos_longitude;
+	frame->rotation[1][1] = -sin_latitude * sin_longitude;
+	frame->rotation[1][2] = cos_latitude;
+	frame->rotation[2][0] = cos_latitude * cos_longitude;
+	frame->rotation[2][1] = cos_latitude * sin_longitude;
+	frame->rotation[2][2] = sin_latitude;
+
+	frame->enabled = 1;
+}
+
+static void enu_update(neo_m8_obj_t* self){
+	/**
+	 * Projects the latest fix into the local tangent plane (mm east/north/up of the origin)
+	 * Within ENU_SERIES_RANGE_M of the origin, a second-order series in the latitude/longitude/height differences with the cached factors
+	 * is within a few mm of the exact result - further out, the fix goes through the full conversion to ECEF
+	*/
+	enu_frame_t* frame = &(self->enu);
+	int32_t height_mm = fix_height_mm(self);
+	double latitude_difference = (self->data.latitude_e7 - frame->origin_latitude_e7) * E7_TO_RAD_DOUBLE;
+	double longitude_difference = self->data.longitude_e7 - frame->origin_longitude_e7;
+	double height_difference = (height_mm - frame->origin_height_mm) / 1000.0;
+	double east, north, up;
+	double ecef[3];
+	uint8_t i;
+
+	// Taking the short way round across the antimeridian
+	if (longitude_difference > 1800000000.0){
+		longitude_difference -= 3600000000.0;
+	}
+	else if (longitude_difference < -1800000000.0){
+		longitude_difference += 3600000000.0;
+	}
+	longitude_difference *= E7_TO_RAD_DOUBLE;
+
+	east = (frame->prime_vertical_radius + height_difference) * frame->cos_latitude * longitude_difference;
+	north = (frame->meridian_radius + height_difference) * latitude_difference;
+
+	if ((fabs(east) < ENU_SERIES_RANGE_M) && (fabs(north) < ENU_SERIES_RANGE_M)){
+		// Second-order terms - parallels curving away from the east axis, the radius of curvature changing with latitude, and the
+		// surface dropping away from the plane
+		east -= frame->meridian_radius * frame->sin_latitude * latitude_difference * longitude_difference;
+		north += frame->prime_vertical_radius * frame->sin_latitude * frame->cos_latitude * longitude_difference*longitude_difference / 2 +
+		         frame->north_curvature * latitude_difference*latitude_difference;
+		up = height_difference - (frame->meridian_radius * latitude_difference*latitude_difference +
+		     frame->prime_vertical_radius * frame->cos_latitude*frame->cos_latitude * longitude_difference*longitude_difference) / 2;
+	}
+	else {
+		geodetic_to_ecef(self->data.latitude_e7 / 1e7, self->data.longitude_e7 / 1e7, height_mm / 1000.0, ecef);
+
+		for (i = 0; i < 3; i++){
+			ecef[i] -= frame->origin_ecef[i];
+		}
+
+		east = frame->rotation[0][0]*ecef[0] + frame->rotation[0][1]*ecef[1];
+		north = frame->rotation[1][0]*ecef[0] + frame->rotation[1][1]*ecef[1] + frame->rotation[1][2]*ecef[2];
+		up = frame->rotation[2][0]*ecef[0] + frame->rotation[2][1]*ecef[1] + frame->rotation[2][2]*ecef[2];
+	}
+
+	frame->east_mm = 1000 * east;
+	frame->north_mm = 1000 * north;
+	frame->up_mm = 1000 * up;
+}
+
+static int32_t fix_height_mm(neo_m8_obj_t* self){
+	/**
+	 * Returns the latest fix's height above the WGS84 ellipsoid (mm) - its altitude is above mean sea level, so the geoid separation
+	 * from GGA is added back
+	*/
+	return self->data.altitude_mm + (int32_t)(self->data.geosep * 1000);
+}
+
+static void kalman_position_fix(neo_m8_obj_t* self){
+	/**
+	 * Feeds a position fix into the Kalman filter, weighted by its reported error
+	 * If no local tangent plane origin has been set with set_origin(), the first fix after the filter is enabled becomes it
+	*/
+	kalman_t* filter = &(self->kalman);
+	float east, north, up, horizontal_sigma, vertical_sigma, horizontal_variance, vertical_variance;
+	uint8_t i;
+
+	horizontal_sigma = (self->data.position_error > 0) ? self->data.position_error : KALMAN_UNKNOWN_POSITION_SIGMA;
+	vertical_sigma = (self->data.vertical_error > 0) ? self->data.vertical_error : 2*horizontal_sigma;
+
+	if (horizontal_sigma < KALMAN_MIN_POSITION_SIGMA){
+		horizontal_sigma = KALMAN_MIN_POSITION_SIGMA;
+	}
+	if (vertical_sigma < KALMAN_MIN_POSITION_SIGMA){
+		vertical_sigma = KALMAN_MIN_POSITION_SIGMA;
+	}
+
+	horizontal_variance = horizontal_sigma * horizontal_sigma;
+	vertical_variance = vertical_sigma * vertical_sigma;
+
+	// The filter works in the local tangent plane - centred on this fix if no origin has been set
+	if (!self->enu.enabled){
+		enu_set_origin(&(self->enu), self->data.latitude_e7 / 1e7, self->data.longitude_e7 / 1e7, fix_height_mm(self) / 1000.0);
+		enu_update(self);
+	}
+
+	east = self->enu.east_mm / 1000.0f;
+	north = self->enu.north_mm / 1000.0f;
+	up = self->enu.up_mm / 1000.0f;
+
+	if (!filter->initialised){
+		filter->utc_us = self->data.fix_utc_us;
+
+		for (i = 0; i < 3; i++){
+			filter->axes[i].position = (i == 0) ? east : ((i == 1) ? north : up);
+			filter->axes[i].velocity = 0;
+			filter->axes[i].p00 = (i == 2) ? vertical_variance : horizontal_variance;
+			filter->axes[i].p01 = 0;
+			filter->axes[i].p11 = KALMAN_VELOCITY_SIGMA*KALMAN_VELOCITY_SIGMA*100;
+		}
+
+		filter->initialised = 1;
+		return;
+	}
+
+	kalman_predict(filter, self->data.fix_utc_us);
+
+	kalman_update_position(&(filter->axes[0]), east, horizontal_variance);
+	kalman_update_position(&(filter->axes[1]), north, horizontal_variance);
+	kalman_update_position(&(filter->axes[2]), up, vertical_variance);
+}
+
+static void kalman_velocity_fix(neo_m8_obj_t* self){
+	/**
+	 * Feeds a velocity (from RMC or PUBX,00) into the Kalman filter, weighted by the receiver's speed accuracy if there's one from this epoch
+	 * The vertical velocity is only used if there is one - from UBX-NAV-VELNED/NAV-PVT or PUBX,00
+	*/
+	kalman_t* filter = &(self->kalman);
+	float variance = KALMAN_VELOCITY_SIGMA*KALMAN_VELOCITY_SIGMA;
+
+	if (!filter->initialised){
+		return;
+	}
+
+	if (accuracy_fresh(self->accuracy.velocity_time_of_day_ms, self->data.time.time_of_day_ms) && (self->accuracy.speed_mms > 0)){
+		variance = (self->accuracy.speed_mms / 1000.0f) * (self->accuracy.speed_mms / 1000.0f);
+	}
+
+	kalman_predict(filter, self->data.time.utc_us);
+
+	kalman_update_velocity(&(filter->axes[0]), self->data.velocity_east_mms / 1000.0f, variance);
+	kalman_update_velocity(&(filter->axes[1]), self->data.velocity_north_mms / 1000.0f, variance);
+
+	if (accuracy_fresh(self->data.velocity_time_of_day_ms, self->data.time.time_of_day_ms)){
+		kalman_update_velocity(&(filter->axes[2]), -self->data.velocity_down_mms / 1000.0f, variance);
+	}
+}
+
+static int64_t utc_now_us(neo_m8_obj_t* self){
+	/**
+	 * Estimates the current UTC time (microseconds since 1970-01-01) without reading the UART
+	 * Interpolated from the latest PPS edge if there is one, otherwise from when the last GGA/RMC arrived. Returns 0 if the time isn't known yet
+	*/
+	int64_t now_us = esp_timer_get_time();
+
+	if (self->pps.paired_count != 0){
+		return pps_utc_now(&(self->pps), now_us);
+	}
+
+	if (self->time_received_us != 0){
+		return self->received_time.utc_us + (now_us - self->time_received_us);
+	}
+
+	return 0;
+}
+
+static void extrapolate_position(neo_m8_obj_t* self, int64_t utc_us, int32_t* output){
+	/**
+	 * Extrapolates the last fix to a UTC time using its velocity, entirely in integer maths
+	 * Output is [latitude (1e-7 degrees), longitude (1e-7 degrees), altitude (mm), 1 sigma uncertainty (mm)]
+	 * The uncertainty grows from the fix's position error with the speed uncertainty and an assumed manoeuvring acceleration
+	*/
+	int64_t dt_us = utc_us - self->data.fix_utc_us, north_mm, east_mm, down_mm;
+
+	// Not extrapolating backwards, or too far forwards for the model to mean anything
+	if (dt_us < 0){
+		dt_us = 0;
+	}
+	if (dt_us > EXTRAPOLATION_MAX_US){
+		dt_us = EXTRAPOLATION_MAX_US;
+	}
+
+	north_mm = (int64_t)(self->data.velocity_north_mms) * dt_us / 1000000;
+	east_mm = (int64_t)(self->data.velocity_east_mms) * dt_us / 1000000;
+	down_mm = (int64_t)(self->data.velocity_down_mms) * dt_us / 1000000;
+
+	output[0] = self->data.latitude_e7 + north_mm * 10000000 / MM_PER_DEGREE;
+	output[1] = self->data.longitude_e7 + east_mm * 10000000 / self->data.lon_mm_per_degree;
+	output[2] = self->data.altitude_mm - down_mm;
+	output[3] = self->data.position_error_mm + EXTRAPOLATION_SPEED_SIGMA_MMS * dt_us / 1000000
+	          + EXTRAPOLATION_ACCELERATION_MMS2 * (dt_us / 1000) * (dt_us / 1000) / 2000000;
+}
+
+static int8_t parse_gga(neo_m8_obj_t* self){
+    /**
+     * Parses the GGA NMEA sentence
+     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
+    */
+    nmea_sentence_data_t gga_sentence;
+    char gga_copy[NMEA_MAX_LENGTH + 1], *gga_split[15];
+    uint8_t field_count;
+
+    // Collecting sentence position in buffer
+    get_sentence(self, &gga_sentence, "GGA\0");
+
+    // Checking for null pointer
+    if (gga_sentence.sentence_start == NULL){
+        return -1;
+    }
+
+    // Creating a copy of the GGA sentence as splitting it is destructive
+    strncpy(gga_copy, (char*)(gga_sentence.sentence_start), gga_sentence.length);
+    gga_copy[gga_sentence.length] = '\0';
+
+    // Splitting the GGA sentence up into sections, keeping empty ones so the geoid separation is always field 11
+    field_count = split_nmea_sentence(gga_copy, gga_split, 15);
+
+    // If not enough fields OR the fix isn't one the policy accepts, then return zero
+    // The sentence is removed from the buffer either way, so a rejected fix isn't found again by the next call
+	if ((field_count < 12) || !fix_accepted(self, atoi(gga_split[6]), atoi(gga_split[7]), self->gsa.pdop)){
+        memmove(gga_sentence.sentence_start, gga_sentence.sentence_start + gga_sentence.length, self->buffer_length-(gga_sentence.sentence_start-self->buffer)-gga_sentence.length);
+        self->buffer_length -= gga_sentence.length;
+
+        return 0;
+	}
+
+    // Fix quality, satellites used and HDOP from GGA - fix type and PDOP/VDOP from this epoch's GSA sentences
+    self->data.fix_quality = atoi(gga_split[6]);
+    self->data.satellites_used = atoi(gga_split[7]);
+    self->data.hdop = atof(gga_split[8]);
+    self->data.fix_type = self->gsa.fix_type;
+    self->data.pdop = self->gsa.pdop;
+    self->data.vdop = self->gsa.vdop;
+
+    // Extracting latitude in 1e-7 degrees
+    self->data.latitude_e7 = extract_lat_long(gga_split[2]);
+
+    if (strcmp(gga_split[3], "S") == 0){
+        self->data.latitude_e7 *= -1;
+	}
+
+    // Extracting longitude in 1e-7 degrees
+    self->data.longitude_e7 = extract_lat_long(gga_split[4]);
+
+	if (strcmp(gga_split[5], "W") == 0){
+        self->data.longitude_e7 *= -1;
+	}
+
+    self->data.latitude = self->data.latitude_e7 / 1e7f;
+    self->data.longitude = self->data.longitude_e7 / 1e7f;
+
+    // Horizontal position error - the receiver's own estimate if there's one from this epoch, otherwise converted from HDOP
+    if (accuracy_fresh(self->accuracy.time_of_day_ms, extract_time_of_day(gga_split[1]))){
+        self->data.position_error = self->accuracy.horizontal_mm / 1000.0f;
+    }
+    else {
+        self->data.position_error = atof(gga_split[8]) * HDOP_TO_ERROR_MM / 1000.0f;
+    }
+
+    // Extracting altitude
+    self->data.altitude = atof(gga_split[9]);
+
+	// Extracting geoid separation
+    self->data.geosep = atof(gga_split[11]);
+    self->data.geosep_valid = (gga_split[11][0] != '\0');
+
+    // Extracting UTC time - GGA doesn't have the date, so the last one from RMC is used
+    update_utc_time(&(self->data.time), extract_time_of_day(gga_split[1]), -1);
+
+    // Removing this NMEA sentence from the buffer before the fix is used - logging it can raise (e.g. a full filesystem),
+    // and the same fix mustn't be found again on the next call
+    memmove(gga_sentence.sentence_start, gga_sentence.sentence_start + gga_sentence.length, self->buffer_length-(gga_sentence.sentence_start-self->buffer)-gga_sentence.length);
+    self->buffer_length -= gga_sentence.length;
+
+    process_fix(self);
+
+    return 1;
+}
+
+static int8_t parse_rmc(neo_m8_obj_t* self){
+    /**
+     * Parses the RMC NMEA sentence
+     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
+    */
+    nmea_sentence_data_t rmc_sentence;
+    char rmc_copy[NMEA_MAX_LENGTH + 1], *rmc_split[14];
+    uint8_t field_count;
+
+    // Collecting RMC sentence position in buffer
+    get_sentence(self, &rmc_sentence, "RMC\0");
+
+	// Checking for null pointers
+    if (rmc_sentence.sentence_start == NULL){
+        return -1;
+	}
+
+	// Creating a copy of the RMC sentence as splitting it is destructive
+	// Sized for NMEA_MAX_LENGTH (82 characters, the maximum sentence length in NMEA 0183 Version 4.10) plus the terminator
+    strncpy(rmc_copy, (char*)(rmc_sentence.sentence_start), rmc_sentence.length);
+    rmc_copy[rmc_sentence.length] = '\0';
+
+    // Splitting the RMC sentence up into sections, keeping empty ones so the date is always field 9
+    field_count = split_nmea_sentence(rmc_copy, rmc_split, 14);
+
+    // If not enough fields OR status flag indicates bad fix, then return zero
+    // The sentence is removed from the buffer either way, so a rejected fix isn't found again by the next call
+	if ((field_count < 10) || (strcmp(rmc_split[2], "A") != 0)){
+        memmove(rmc_sentence.sentence_start, rmc_sentence.sentence_start + rmc_sentence.length, self->buffer_length-(rmc_sentence.sentence_start-self->buffer)-rmc_sentence.length);
+        self->buffer_length -= rmc_sentence.length;
+
+        return 0;
+	}
+
+    // Extracting UTC date and time
+    update_utc_time(&(self->data.time), extract_time_of_day(rmc_split[1]), extract_date(rmc_split[9]));
+
+	// Extracting SOG (knots)
+    self->data.sog = atof(rmc_split[7]);
+
+	// Extracting COG (degrees)
+    // The field is empty if the SOG isn't high enough for an accurate COG to be calculated. So -1 is saved instead
+    if (rmc_split[8][0] == '\0'){
+        self->data.cog = -1;
+	}
+    else {
+        self->data.cog = atof(rmc_split[8]);
+    }
+
+    // Splitting the velocity into north/east (mm/s) for extrapolation - treated as stationary if there's no valid course
+    if (self->data.cog == -1){
+        self->data.velocity_north_mms = 0;
+        self->data.velocity_east_mms = 0;
+    }
+    else {
+        self->data.velocity_north_mms = self->data.sog * KNOTS_TO_MMS * cosf(self->data.cog * DEG_TO_RAD);
+        self->data.velocity_east_mms = self->data.sog * KNOTS_TO_MMS * sinf(self->data.cog * DEG_TO_RAD);
+    }
+
+    // RMC has no vertical velocity - the receiver's NED velocity is used instead if it's being output
+    self->data.velocity_down_mms = 0;
+    velocity_ned_fix(self, self->data.time.time_of_day_ms);
+
+    if (self->kalman.enabled){
+        kalman_velocity_fix(self);
+    }
+
+    // Removing this NMEA sentence from the buffer
+    memmove(rmc_sentence.sentence_start, rmc_sentence.sentence_start + rmc_sentence.length, self->buffer_length-(rmc_sentence.sentence_start-self->buffer)-rmc_sentence.length);
+    self->buffer_length -= rmc_sentence.length;
+
+    return 1;
+}
+
+static int8_t parse_gsa(neo_m8_obj_t* self){
+    /**
+     * Parses the GSA NMEA sentence
+     * Returns 1 if all good, -1 if no sentence found, 0 if bad sentence
+    */
+    nmea_sentence_data_t gsa_sentence;
+    char field[6];
+    uint8_t i, comma_count = 0, field_end = 0;
+
+    // Getting pointer to the start of the GSA sentence in the buffer
+    get_sentence(self, &gsa_sentence, "GSA\0");
+
+    // Checking for null pointer
+    if (gsa_sentence.sentence_start == NULL){
+        return -1;
+	}
+
+    // Searching backwards through the GSA sentence for the field
+    for (i = gsa_sentence.length; i > 0; i--){
+        // Looking for commas
+        if (*(gsa_sentence.sentence_start + i) == ','){
+            comma_count ++;
+
+            // First comma found is the end of the VDOP field
+            if (comma_count == 1){
+                field_end = i;
+            }
+
+            // Find second comma at start of VDOP field
+            if (comma_count == 2){
+                break;
+            }
+        }
+    }
+    // If there's some invalid GSA sentence and it doesn't have 2 commas, return
+    if (comma_count != 2){
+        return -1;
+    }
+
+    // Copying the field out
+    strncpy(field, (char*)(gsa_sentence.sentence_start + i + 1), field_end-i-1);
+    field[field_end-i-1] = '\0';
+
+    // Vertical error - the receiver's own estimate if there's one from the last fix's epoch (GSA has no time), otherwise converted from VDOP
+    if (accuracy_fresh(self->accuracy.time_of_day_ms, self->data.time.time_of_day_ms)){
+        self->data.vertical_error = self->accuracy.vertical_mm / 1000.0f;
+    }
+    else {
+        self->data.vertical_error = atof(field)*5;
+    }
+
+    // Removing this NMEA sentence from the buffer
+    memmove(gsa_sentence.sentence_start, gsa_sentence.sentence_start + gsa_sentence.length, self->buffer_length-(gsa_sentence.sentence_start-self->buffer)-gsa_sentence.length);
+    self->buffer_length -= gsa_sentence.length;
+
+    return 1;
+}
+
+static int8_t parse_pubx(neo_m8_obj_t* self){
+    /**
+     * Parses the latest PUBX,00 sentence kept by the framing layer - position, altitude, errors, speed and course all in one sentence,
+     * so the whole fix pipeline can run from it alone
+     * Returns 1 if all good, -1 if no new sentence arrived, 0 if bad sentence (including no fix)
+    */
+    char pubx_copy[PUBX_MAX_LENGTH + 1], *pubx_split[PUBX_FIELD_COUNT], *status;
+    uint64_t start_time = esp_timer_get_time();
+    uint8_t field_count, quality, satellites_used;
+    float hdop, vdop, pdop;
+
+    // Waiting up to 0.2 seconds for a new sentence, like get_sentence()
+    while (!self->pubx.pending && (esp_timer_get_time() - start_time < 2e5)){
+        update_buffer_internal(self);
+    }
+
+    if (!self->pubx.pending){
+        return -1;
+    }
+
+    memcpy(pubx_copy, self->pubx.sentence, self->pubx.length + 1);
+    self->pubx.pending = 0;
+
+    field_count = split_nmea_sentence(pubx_copy, pubx_split, PUBX_FIELD_COUNT);
+
+    if (field_count < 19){
+        return 0;
+    }
+
+    // Navigation status, mapped onto the GGA quality indicator for the fix policy - G2/G3 and combined GNSS/dead reckoning (RK) as GPS,
+    // D2/D3 as DGPS/SBAS, dead reckoning only (DR) as estimated, and no fix (NF) or time only (TT) as invalid
+    status = pubx_split[8];
+
+    if (((status[0] == 'G') || (status[0] == 'D')) && ((status[1] == '2') || (status[1] == '3'))){
+        quality = (status[0] == 'D') ? 2 : 1;
+    }
+    else if (strcmp(status, "RK") == 0){
+        quality = 1;
+    }
+    else if (strcmp(status, "DR") == 0){
+        quality = 6;
+    }
+    else {
+        quality = 0;
+    }
+
+    // PUBX,00 has no PDOP, but it's the root sum square of HDOP and VDOP
+    satellites_used = atoi(pubx_split[18]);
+    hdop = atof(pubx_split[15]);
+    vdop = atof(pubx_split[16]);
+    pdop = sqrtf(hdop*hdop + vdop*vdop);
+
+    if (!fix_accepted(self, quality, satellites_used, pdop)){
+        return 0;
+    }
+    if ((strchr(pubx_split[3], '.') == NULL) || (strchr(pubx_split[5], '.') == NULL)){
+        return 0;
+    }
+
+    // Extracting latitude/longitude in 1e-7 degrees
+    self->data.latitude_e7 = extract_lat_long(pubx_split[3]);
+
+    if (pubx_split[4][0] == 'S'){
+        self->data.latitude_e7 *= -1;
+    }
+
+    self->data.longitude_e7 = extract_lat_long(pubx_split[5]);
+
+    if (pubx_split[6][0] == 'W'){
+        self->data.longitude_e7 *= -1;
+    }
+
+    self->data.latitude = self->data.latitude_e7 / 1e7f;
+    self->data.longitude = self->data.longitude_e7 / 1e7f;
+
+    // PUBX,00 gives the height above the ellipsoid - converted to above mean sea level with the last geoid separation from GGA. Until
+    // there has been one, it's left as the height above the ellipsoid, and altitude()/getdata() give the geoid separation as None
+    self->data.altitude = atof(pubx_split[7]) - (self->data.geosep_valid ? self->data.geosep : 0);
+
+    // The receiver's own horizontal/vertical accuracy estimates
+    self->data.position_error = atof(pubx_split[9]);
+    self->data.vertical_error = atof(pubx_split[10]);
+
+    // SOG (km/h, converted to knots to match RMC) and COG (degrees)
+    self->data.sog = atof(pubx_split[11]) * KMH_TO_KNOTS;
+
+    if (pubx_split[12][0] == '\0'){
+        self->data.cog = -1;
+        self->data.velocity_north_mms = 0;
+        self->data.velocity_east_mms = 0;
+    }
+    else {
+        self->data.cog = atof(pubx_split[12]);
+        self->data.velocity_north_mms = self->data.sog * KNOTS_TO_MMS * cosf(self->data.cog * DEG_TO_RAD);
+        self->data.velocity_east_mms = self->data.sog * KNOTS_TO_MMS * sinf(self->data.cog * DEG_TO_RAD);
+    }
+
+    // Vertical velocity (m/s, positive downwards) - the NED velocity snapshot comes from PUBX,00 unless UBX-NAV-VELNED/NAV-PVT is being output
+    self->data.velocity_down_mms = atof(pubx_split[13]) * 1000;
+
+    if (!velocity_ned_fix(self, extract_time_of_day(pubx_split[2]))){
+        self->data.velocity_north_cms = self->data.velocity_north_mms / 10;
+        self->data.velocity_east_cms = self->data.velocity_east_mms / 10;
+        self->data.velocity_down_cms = self->data.velocity_down_mms / 10;
+        self->data.speed_accuracy_cms = -1;
+        self->data.velocity_source = VELOCITY_SOURCE_PUBX;
+        self->data.velocity_received_us = self->time_received_us;
+        self->data.velocity_time_of_day_ms = extract_time_of_day(pubx_split[2]);
+    }
+
+    // Fix quality - combined GNSS/dead reckoning fixes are counted as 3D
+    self->data.fix_quality = quality;
+    self->data.fix_type = ((status[1] >= '2') && (status[1] <= '3')) ? (status[1] - '0') : ((quality != 0) ? 3 : 1);
+    self->data.satellites_used = satellites_used;
+    self->data.pdop = pdop;
+    self->data.hdop = hdop;
+    self->data.vdop = vdop;
+
+    // Extracting UTC time - PUBX,00 doesn't have the date, so the last one from RMC is used
+    update_utc_time(&(self->data.time), extract_time_of_day(pubx_split[2]), -1);
+
+    process_fix(self);
+
+    if (self->kalman.enabled){
+        kalman_velocity_fix(self);
+    }
+
+    return 1;
+}
+
+static void pubx_poll(neo_m8_obj_t* self){
+	/**
+	 * In PUBX,00 mode, polls for the sentence if it's due - doesn't wait for the response, which is picked up by the framing layer whenever it arrives
+	*/
+	static const char poll[] = "$PUBX,00*33\r\n";
+	pubx_t* pubx = &(self->pubx);
+	int64_t now_us;
+
+	if (!pubx->enabled || (pubx->poll_period_ms == 0)){
+		return;
+	}
+
+	now_us = esp_timer_get_time();
+
+	if (now_us - pubx->polled_us >= 1000*(int64_t)(pubx->poll_period_ms)){
+		if (uart_write_bytes(self->uart_number, poll, sizeof(poll) - 1) != sizeof(poll) - 1){
+			mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+		}
+
+		pubx->polled_us = now_us;
+	}
+}
+
+static void cfg_rate_write(neo_m8_obj_t* self, uint16_t meas_rate_ms, uint16_t nav_rate, uint16_t time_ref){
+	/**
+	 * Sends UBX-CFG-RATE to set the navigation rate - doesn't wait for the ACK/NACK
+	 * The PUBX,00 polling period is kept in step with the new solution period, unless it isn't being polled
+	*/
+	uint8_t payload[6] = {meas_rate_ms & 0xFF, meas_rate_ms >> 8, nav_rate & 0xFF, nav_rate >> 8, time_ref & 0xFF, time_ref >> 8};
+
+	ubx_write_packet(self, 0x06, 0x08, payload, 6);
+
+	if (self->pubx.poll_period_ms != 0){
+		self->pubx.poll_period_ms = (uint32_t)(meas_rate_ms) * nav_rate;
+	}
+}
+
+static int8_t cfg_rate_read(neo_m8_obj_t* self){
+	/**
+	 * Polls UBX-CFG-RATE, which the framing layer decodes into self->rate when it arrives (before the poll's ACK)
+	 * Returns 1 if the rate was read back, 0 if the poll was NACKed, and -1 if nothing received
+	*/
+	uint8_t sequence = self->rate.sequence;
+	uint8_t empty[1];
+	int8_t flag;
+
+	ubx_write_packet(self, 0x06, 0x08, empty, 0);
+	flag = ubx_ack_nack(self, 0x06, 0x08);
+
+	if ((flag == 1) && (self->rate.sequence == sequence)){
+		return -1;
+	}
+
+	return flag;
+}
+
+static void rate_adapt(neo_m8_obj_t* self){
+	/**
+	 * Adaptive navigation rate - checked with each fix. Switches to the fast rate as soon as the speed goes above the threshold, and back to
+	 * the slow rate once it's been below half the threshold for the hold time, so it doesn't flip back and forth around the threshold
+	 * The speed is from the receiver's NED velocity if there's one from this epoch, otherwise from the last RMC/PUBX,00
+	 * Switches don't wait for their ACK - the framing layer picks it up, and the rate only counts as switched once it has. A switch
+	 * that isn't ACKed is sent again after the hold time (at least RATE_ADAPT_MIN_RETRY_MS), not with every fix
+	*/
+	nav_rate_t* rate = &(self->rate);
+	int64_t now_us = esp_timer_get_time();
+	int64_t retry_us = 1000*(int64_t)((rate->hold_ms > RATE_ADAPT_MIN_RETRY_MS) ? rate->hold_ms : RATE_ADAPT_MIN_RETRY_MS);
+	uint8_t fast;
+	float speed_mms;
+
+	if (!rate->switch_ack.waiting && (rate->switch_ack.result == 1)){
+		rate->fast = rate->switch_fast;
+		rate->switch_ack.result = -1;
+		rate->switch_ack.sent_us = 0;
+	}
+
+	if (accuracy_fresh(self->data.velocity_time_of_day_ms, self->data.time.time_of_day_ms)){
+		speed_mms = 10*sqrtf((float)(self->data.velocity_north_cms)*self->data.velocity_north_cms
+		                     + (float)(self->data.velocity_east_cms)*self->data.velocity_east_cms);
+	}
+	else {
+		speed_mms = self->data.sog * KNOTS_TO_MMS;
+	}
+
+	if (speed_mms > rate->threshold_mms / 2){
+		rate->moving_us = now_us;
+	}
+
+	fast = rate->fast ? (now_us - rate->moving_us < 1000*(int64_t)(rate->hold_ms)) : (speed_mms > rate->threshold_mms);
+
+	// Only one switch is in flight at a time, and one that wasn't ACKed (or hasn't been yet) is left until it's due a retry
+	if ((fast == rate->fast) || ((rate->switch_ack.sent_us != 0) && (now_us - rate->switch_ack.sent_us < retry_us))){
+		return;
+	}
+
+	cfg_rate_write(self, fast ? rate->fast_meas_rate_ms : rate->slow_meas_rate_ms, rate->nav_rate, rate->time_ref);
+	ubx_pending_start(&(rate->switch_ack), 0x06, 0x08);
+	rate->switch_fast = fast;
+}
+
+static uint8_t fix_accepted(neo_m8_obj_t* self, uint8_t quality, uint8_t satellites_used, float pdop){
+	/**
+	 * Checks a fix against the acceptance policy set by fix_policy()
+	 * A PDOP of 0 means it isn't known yet (no GSA so far), which doesn't count against the fix
+	 * Returns 1 if the fix should be used, 0 if not
+	*/
+	fix_policy_t* policy = &(self->fix_policy);
+
+	if ((quality == 0) || (quality > FIX_QUALITY_MAX) || !(policy->qualities & (1 << quality))){
+		return 0;
+	}
+	if (satellites_used < policy->min_satellites){
+		return 0;
+	}
+	if ((policy->max_pdop > 0) && (pdop > policy->max_pdop)){
+		return 0;
+	}
+
+	return 1;
+}
+
+static void decode_gsa(neo_m8_obj_t* self){
+	/**
+	 * Decodes a GSA sentence from the framing layer into the used satellite table - fix type, DOPs and the PRNs used in the fix
+	 * With several constellations the module sends one GSA per constellation each epoch, so the first GSA after any other sentence
+	 * clears out the PRNs of the previous epoch, and the rest add to them
+	*/
+	gsa_table_t* table = &(self->gsa);
+	char gsa_copy[NMEA_MAX_LENGTH + 1], *gsa_split[20];
+	uint8_t i, field_count;
+	int8_t talker;
+	int16_t value;
+
+	if (self->frame_length > NMEA_MAX_LENGTH){
+		return;
+	}
+
+	// Creating a copy of the GSA sentence as splitting it is destructive
+	memcpy(gsa_copy, self->frame, self->frame_length);
+	gsa_copy[self->frame_length] = '\0';
+
+	field_count = split_nmea_sentence(gsa_copy, gsa_split, 20);
+
+	if (field_count < 18){
+		return;
+	}
+
+	if (!table->in_progress){
+		table->count = 0;
+		table->in_progress = 1;
+	}
+
+	// NMEA 4.10 adds the GNSS system ID as field 18, needed as multi-constellation GSA sentences all use the GN talker
+	// System IDs 1-5 (GPS, GLONASS, Galileo, BeiDou, QZSS) line up with the GSV talker indexes
+	if ((field_count > 18) && (gsa_split[18][0] >= '1') && (gsa_split[18][0] <= '5')){
+		talker = gsa_split[18][0] - '1';
+	}
+	else {
+		talker = gsv_talker_index(gsa_copy[1], gsa_copy[2]);
+
+		if (talker < 0){
+			talker = GSV_TALKER_COUNT - 1;
+		}
+	}
+
+	table->fix_type = atoi(gsa_split[2]);
+
+	// Satellites used are fields 3-14, with the unused ones left empty
+	for (i = 3; (i <= 14) && (table->count < GSA_MAX_SATELLITES); i++){
+		if (gsa_split[i][0] == '\0'){
+			continue;
+		}
+
+		value = atoi(gsa_split[i]);
+		table->prn[table->count] = (value > 255) ? 255 : value;
+		table->talker[table->count] = talker;
+		table->count++;
+	}
+
+	table->pdop = atof(gsa_split[15]);
+	table->hdop = atof(gsa_split[16]);
+	table->vdop = atof(gsa_split[17]);
+}
+
+static void gsv_remove_talker(gsv_table_t* table, uint8_t talker){
+	/**
+	 * Removes every satellite belonging to one talker from the GSV table, compacting the arrays in place
+	*/
+	uint8_t i, kept = 0;
+
+	for (i = 0; i < table->count; i++){
+		if (table->talker[i] == talker){
+			continue;
+		}
+
+		if (kept != i){
+			table->prn[kept] = table->prn[i];
+			table->elevation[kept] = table->elevation[i];
+			table->azimuth[kept] = table->azimuth[i];
+			table->cno[kept] = table->cno[i];
+			table->talker[kept] = table->talker[i];
+		}
+		kept++;
+	}
+
+	table->count = kept;
+}
+
+static void gsv_commit_talker(gsv_table_t* table, gsv_table_t* staging, uint8_t talker){
+	/**
+	 * Replaces one talker's satellites in the GSV table with its completed group from the staging table, which is then cleared of them
+	*/
+	uint8_t i, index;
+
+	gsv_remove_talker(table, talker);
+
+	for (i = 0; (i < staging->count) && (table->count < GSV_MAX_SATELLITES); i++){
+		if (staging->talker[i] != talker){
+			continue;
+		}
+
+		index = table->count;
+		table->prn[index] = staging->prn[i];
+		table->elevation[index] = staging->elevation[i];
+		table->azimuth[index] = staging->azimuth[i];
+		table->cno[index] = staging->cno[i];
+		table->talker[index] = talker;
+		table->count++;
+	}
+
+	gsv_remove_talker(staging, talker);
+}
+
+static int8_t decode_gsv(neo_m8_obj_t* self, char* sentence, uint8_t length){
+	/**
+	 * Decodes a single GSV sentence into the satellite table
+	 * Multi-part groups are assembled per talker in the staging table, and only replace that talker's satellites once the last message
+	 * arrives - a message arriving out of sequence drops the whole group, leaving the previous one in place, rather than publishing a partial one
+	 * Returns 1 if all good, 0 if bad sentence
+	*/
+	gsv_table_t* table = &(self->satellites_staging);
+	char gsv_copy[NMEA_MAX_LENGTH + 1], *gsv_split[21];
+	uint8_t i, field_count, total_messages, message_number, index;
+	int8_t talker;
+	int16_t value;
+
+	if (length > NMEA_MAX_LENGTH){
+		return 0;
+	}
+
+	// Creating a copy of the GSV sentence as splitting it is destructive
+	memcpy(gsv_copy, sentence, length);
+	gsv_copy[length] = '\0';
+
+	field_count = split_nmea_sentence(gsv_copy, gsv_split, 21);
+	talker = gsv_talker_index(gsv_copy[1], gsv_copy[2]);
+
+	if ((field_count < 4) || (talker < 0)){
+		return 0;
+	}
+
+	total_messages = atoi(gsv_split[1]);
+	message_number = atoi(gsv_split[2]);
+
+	// First message of a group - clearing out anything left over from an unfinished group
+	if (message_number == 1){
+		gsv_remove_talker(table, talker);
+		table->next_message[talker] = 1;
+	}
+
+	if ((message_number != table->next_message[talker]) || (message_number > total_messages)){
+		gsv_remove_talker(table, talker);
+		table->next_message[talker] = 0;
+		return 0;
+	}
+
+	// Each satellite is a block of 4 fields (PRN, elevation, azimuth, C/N0) starting at field 4
+	// NMEA 4.10 adds a signal ID field after the last block, which the bounds check skips over
+	for (i = 4; (i + 3 < field_count) && (table->count < GSV_MAX_SATELLITES); i += 4){
+		if (gsv_split[i][0] == '\0'){
+			continue;
+		}
+
+		index = table->count;
+
+		value = atoi(gsv_split[i]);
+		table->prn[index] = (value > 255) ? 255 : value;
+
+		// Elevation/azimuth are empty if the satellite's position isn't known yet - stored as 255/-1
+		table->elevation[index] = (gsv_split[i+1][0] == '\0') ? 255 : atoi(gsv_split[i+1]);
+		table->azimuth[index] = (gsv_split[i+2][0] == '\0') ? -1 : atoi(gsv_split[i+2]);
+
+		// C/N0 is empty if the satellite isn't being tracked - stored as 0
+		table->cno[index] = atoi(gsv_split[i+3]);
+		table->talker[index] = talker;
+
+		table->count++;
+	}
+
+	// Last message of the group - publishing it
+	if (message_number == total_messages){
+		table->next_message[talker] = 0;
+		gsv_commit_talker(&(self->satellites), table, talker);
+	}
+	else {
+		table->next_message[talker] = message_number + 1;
+	}
+
+	return 1;
+}
+
+mp_obj_t update_buffer(mp_obj_t self_in){
+	/**
+	 * Exposing the update_buffer_internal function to micropython
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+	update_buffer_internal(self);
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_update_buffer_obj, update_buffer);
+
+mp_obj_t position(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns location data: latitude, longitude, position error, timestamp
+	 *                    |degrees/decimal minutes|    meters    | UTC microseconds since 1970-01-01
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int8_t err;
+
+    err = self->pubx.enabled ? parse_pubx(self) : parse_gga(self);
+
+    // Checking for errors
+    if (err != 1){
+		return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_int(0)});
+	}
+
+    return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(self->data.latitude),
+                                            mp_obj_new_float(self->data.longitude),
+                                            mp_obj_new_float(self->data.position_error),
+                                            mp_obj_new_int_from_ll(self->data.time.utc_us)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_position_obj, position);
+
+mp_obj_t velocity(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns velocity and course data - speed over ground (knots), course over ground (degrees), timestamp (UTC microseconds since 1970-01-01)
+	 * Course over ground is returned as Python Nonetype if not availible due to speed being too low
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int8_t err;
+
+    err = self->pubx.enabled ? parse_pubx(self) : parse_rmc(self);
+
+    // Checking for errors
+    if (err != 1){
+		return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_int(0)});
+	}
+
+    if (self->data.cog == -1){
+        return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(self->data.sog),
+                                                mp_const_none,
+                                                mp_obj_new_int_from_ll(self->data.time.utc_us)});
+    }
+
+    return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(self->data.sog),
+                                            mp_obj_new_float(self->data.cog),
+                                            mp_obj_new_int_from_ll(self->data.time.utc_us)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_velocity_obj, velocity);
+
+mp_obj_t altitude(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns altitude data - altitude AMSL (meters), geoid separation (meters), vertical error (meters), timestamp (UTC microseconds since 1970-01-01)
+	 * The geoid separation is None until a GGA has given it - in PUBX,00 mode, the altitude is then the height above the WGS84 ellipsoid
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    int8_t err1, err2;
+
+    if (self->pubx.enabled){
+        err1 = parse_pubx(self);
+        err2 = err1;
+    }
+    else {
+        err1 = parse_gga(self);
+        err2 = parse_gsa(self);
+    }
+
+    // Checking for errors
+    if ((err1 != 1) || (err2 != 1)){
+		return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_int(0)});
+	}
+
+    return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(self->data.altitude),
+                                            self->data.geosep_valid ? mp_obj_new_float(self->data.geosep) : mp_const_none,
+                                            mp_obj_new_float(self->data.vertical_error),
+                                            mp_obj_new_int_from_ll(self->data.time.utc_us)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_altitude_obj, altitude);
+
+mp_obj_t getdata(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns all availible GPS data - latitude, longitude, position error, altitude, vertical error, speed over ground, course over ground, geoid separation, timestamp
+	 * Latitude/longitude: degrees and decimal minutes
+	 * Position error/altitude/vertical error/geoid separation: meters
+	 * Speed over ground: Knots
+	 * Couse over ground: degrees (or Python Nonetype if speed too low to calculate course)
+	 * Geoid separation: Python Nonetype until a GGA has given it - in PUBX,00 mode, the altitude is then the height above the WGS84 ellipsoid
+	 * Timestamp: UTC microseconds since 1970-01-01 (just since midnight until an RMC sentence has given the date)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    int8_t err1, err2, err3;
+
+    if (self->pubx.enabled){
+        err1 = parse_pubx(self);
+        err2 = err1;
+        err3 = err1;
+    }
+    else {
+        err1 = parse_gga(self);
+        err2 = parse_rmc(self);
+        err3 = parse_gsa(self);
+    }
+
+    // Checking for errors
+    if ((err1 != 1) || (err2 != 1) || (err3 != 1)){
+		return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(0.0f),
+                                                mp_obj_new_float(0.0f),
+												mp_obj_new_float(0.0f),
+                                                mp_obj_new_float(0.0f),
+												mp_obj_new_float(0.0f),
+                                                mp_obj_new_float(0.0f),
+												mp_const_none,
+                                                mp_obj_new_float(0.0f),
+												mp_obj_new_int(0)});
+    }
+
+    // If the COG is invalid, return none instead
+    if (self->data.cog == -1){
+        return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(self->data.latitude),
+                                                mp_obj_new_float(self->data.longitude),
+                                                mp_obj_new_float(self->data.position_error),
+                                                mp_obj_new_float(self->data.altitude),
+                                                mp_obj_new_float(self->data.vertical_error),
+                                                mp_obj_new_float(self->data.sog),
+                                                mp_const_none,
+                                                self->data.geosep_valid ? mp_obj_new_float(self->data.geosep) : mp_const_none,
+                                                mp_obj_new_int_from_ll(self->data.time.utc_us)});
+	}
+
+    return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(self->data.latitude),
+                                            mp_obj_new_float(self->data.longitude),
+                                            mp_obj_new_float(self->data.position_error),
+                                            mp_obj_new_float(self->data.altitude),
+                                            mp_obj_new_float(self->data.vertical_error),
+                                            mp_obj_new_float(self->data.sog),
+                                            mp_obj_new_float(self->data.cog),
+                                            self->data.geosep_valid ? mp_obj_new_float(self->data.geosep) : mp_const_none,
+                                            mp_obj_new_int_from_ll(self->data.time.utc_us)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_getdata_obj, getdata);
+
+mp_obj_t position_at(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Extrapolates the last fix (from position()/getdata()) to a UTC time using the last velocity (from velocity()/getdata())
+	 * Takes the time as UTC microseconds since 1970-01-01 (as returned by gps_time_now()) - defaults to now
+	 * Returns latitude (degrees), longitude (degrees), altitude (meters), 1 sigma uncertainty (meters)
+	 * If an array('i') of at least 4 items is passed as the second argument, it's filled with [latitude (1e-7 degrees),
+	 * longitude (1e-7 degrees), altitude (mm), uncertainty (mm)] and returned instead - this doesn't allocate any memory
+	 * Doesn't read the UART, so it's cheap enough to call at the control loop rate
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	int64_t utc_us;
+	int32_t output[4];
+	mp_buffer_info_t buffer;
+
+	if ((n_args < 2) || (args[1] == mp_const_none)){
+		utc_us = utc_now_us(self);
+	}
+	else {
+		utc_us = mp_obj_get_ll(args[1]);
+	}
+
+	if (n_args == 3){
+		mp_get_buffer_raise(args[2], &buffer, MP_BUFFER_WRITE);
+
+		if ((buffer.typecode != 'i') && (buffer.typecode != 'l')){
+			mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('i')"));
+		}
+		if (buffer.len < 4*sizeof(int32_t)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 4 items"));
+		}
+
+		extrapolate_position(self, utc_us, (int32_t*)(buffer.buf));
+		return args[2];
+	}
+
+	extrapolate_position(self, utc_us, output);
+
+	return mp_obj_new_tuple(4, (mp_obj_t[4]){mp_obj_new_float(output[0] / 1e7f),
+	                                         mp_obj_new_float(output[1] / 1e7f),
+	                                         mp_obj_new_float(output[2] / 1000.0f),
+	                                         mp_obj_new_float(output[3] / 1000.0f)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_position_at_obj, 1, 3, position_at);
+
+mp_obj_t history_at(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Returns where the receiver was at a UTC time (microseconds since 1970-01-01, e.g. from gps_time_now()), interpolated from the
+	 * last 64 fixes: latitude (degrees), longitude (degrees), altitude (meters), speed (m/s). Returns None if the time is outside the history
+	 * If an array('i') of at least 4 items is passed as the second argument, it's filled with [latitude (1e-7 degrees),
+	 * longitude (1e-7 degrees), altitude (mm), speed (cm/s)] and returned instead - this doesn't allocate any memory
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	int32_t output[4];
+	mp_buffer_info_t buffer;
+
+	if (n_args == 3){
+		mp_get_buffer_raise(args[2], &buffer, MP_BUFFER_WRITE);
+
+		if ((buffer.typecode != 'i') && (buffer.typecode != 'l')){
+			mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('i')"));
+		}
+		if (buffer.len < 4*sizeof(int32_t)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 4 items"));
+		}
+
+		if (history_lookup(&(self->history), mp_obj_get_ll(args[1]), (int32_t*)(buffer.buf)) != 1){
+			return mp_const_none;
+		}
+		return args[2];
+	}
+
+	if (history_lookup(&(self->history), mp_obj_get_ll(args[1]), output) != 1){
+		return mp_const_none;
+	}
+
+	return mp_obj_new_tuple(4, (mp_obj_t[4]){mp_obj_new_float(output[0] / 1e7f),
+	                                         mp_obj_new_float(output[1] / 1e7f),
+	                                         mp_obj_new_float(output[2] / 1000.0f),
+	                                         mp_obj_new_float(output[3] / 100.0f)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_history_at_obj, 2, 3, history_at);
+
+mp_obj_t history_into(mp_obj_t self_in, mp_obj_t buffer_in){
+	/**
+	 * Micropython-exposed function
+	 * Copies the fix history, oldest first, into a bytearray (or any writable buffer) as packed 22-byte records
+	 * Each record is struct format "<qiiiH": UTC time (microseconds), latitude (1e-7 degrees), longitude (1e-7 degrees), altitude (mm), speed (cm/s)
+	 * Copies as many of the newest records as fit, without allocating any memory. Returns the number of records copied
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	fix_history_t* history = &(self->history);
+	mp_buffer_info_t buffer;
+	uint16_t count, first, i;
+
+	mp_get_buffer_raise(buffer_in, &buffer, MP_BUFFER_WRITE);
+
+	count = buffer.len / sizeof(fix_record_t);
+	if (count > history->count){
+		count = history->count;
+	}
+	first = history->count - count;
+
+	for (i = 0; i < count; i++){
+		memcpy((uint8_t*)(buffer.buf) + i*sizeof(fix_record_t), history_record(history, first + i), sizeof(fix_record_t));
+	}
+
+	return mp_obj_new_int(count);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_history_into_obj, history_into);
+
+mp_obj_t history_view(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns the fix history as two memoryviews straight onto the ring's storage, so no records are copied: (older, newer)
+	 * Read in order, they hold the records oldest first, in the same packed 22-byte "<qiiiH" format as history_into()
+	 * Until the ring has wrapped around, the second view is empty. Like satellites(), the views change as new fixes are added
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	fix_history_t* history = &(self->history);
+	uint16_t oldest = (history->head + FIX_HISTORY_LENGTH - history->count) % FIX_HISTORY_LENGTH;
+	uint16_t first_count = (oldest + history->count > FIX_HISTORY_LENGTH) ? FIX_HISTORY_LENGTH - oldest : history->count;
+
+	return mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_memoryview('B', first_count*sizeof(fix_record_t), history->records + oldest),
+	                                         mp_obj_new_memoryview('B', (history->count - first_count)*sizeof(fix_record_t), history->records)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_history_view_obj, history_view);
+
+mp_obj_t log_start(mp_obj_t self_in, mp_obj_t path){
+	/**
+	 * Micropython-exposed function
+	 * Starts logging every new fix to a binary track file (replacing it if it exists), stopping any log already running
+	 * Fixes are logged as they're read by position()/altitude()/getdata(), and written to flash 4096 bytes at a time
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	track_log_t* track = &(self->track);
+
+	if (track->file != MP_OBJ_NULL){
+		if (track->block_length > 0){
+			track_write_block(self);
+		}
+		track_close(self);
+	}
+
+	track->file = mp_call_function_2(MP_OBJ_FROM_PTR(&mp_builtin_open_obj), path, MP_OBJ_NEW_QSTR(MP_QSTR_wb));
+	track->block = m_new(uint8_t, TRACK_BLOCK_LENGTH);
+	track->fix_count = 0;
+	track->bytes_written = 0;
+
+	// File header - magic, format version, reserved, block length
+	track_start(&(track->encoder), track->block, &(track->block_length));
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_log_start_obj, log_start);
+
+mp_obj_t log_stop(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Writes out the last (padded) block and closes the track log
+	 * Returns (fixes logged, bytes written), or None if no log was running
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	track_log_t* track = &(self->track);
+
+	if (track->file == MP_OBJ_NULL){
+		return mp_const_none;
+	}
+
+	if (track->block_length > 0){
+		track_write_block(self);
+	}
+	track_close(self);
+
+	return mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_int_from_uint(track->fix_count),
+	                                         mp_obj_new_int_from_uint(track->bytes_written)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_log_stop_obj, log_stop);
+
+mp_obj_t record(mp_obj_t self_in, mp_obj_t path){
+	/**
+	 * Micropython-exposed function
+	 * Records every byte read from the module's UART, exactly as received, to a file (replacing it if it exists)
+	 * Passing None stops recording. Returns the number of bytes recorded by the recording that was stopped, or None if there wasn't one
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	stream_recorder_t* recorder = &(self->recorder);
+	mp_obj_t bytes_recorded = mp_const_none;
+
+	if (recorder->file != MP_OBJ_NULL){
+		record_flush(self);
+		if (recorder->block_length > 0){
+			record_write(self, recorder->blocks + recorder->active*RECORD_BLOCK_LENGTH, recorder->block_length);
+		}
+
+		record_close(self);
+		bytes_recorded = mp_obj_new_int_from_uint(recorder->bytes_recorded);
+	}
+
+	if (path != mp_const_none){
+		recorder->file = mp_call_function_2(MP_OBJ_FROM_PTR(&mp_builtin_open_obj), path, MP_OBJ_NEW_QSTR(MP_QSTR_wb));
+		recorder->blocks = m_new(uint8_t, 2*RECORD_BLOCK_LENGTH);
+		recorder->block_length = 0;
+		recorder->active = 0;
+		recorder->pending = 0;
+		recorder->bytes_recorded = 0;
+	}
+
+	return bytes_recorded;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_record_obj, record);
+
+mp_obj_t geofence_add(mp_obj_t self_in, mp_obj_t id_in, mp_obj_t vertices_in){
+	/**
+	 * Micropython-exposed function
+	 * Adds a polygon geofence with an integer ID. Vertices are a list of (latitude, longitude) pairs in degrees,
+	 * or an array('i') of alternating latitudes and longitudes in 1e-7 degrees. Every vertex must be within 1000km of the first geofence's first vertex
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	geofence_set_t* set = &(self->geofences);
+	geofence_polygon_t* polygon;
+	mp_buffer_info_t buffer;
+	mp_obj_t* items;
+	mp_obj_t* pair;
+	size_t vertex_count, i;
+	int32_t id = mp_obj_get_int(id_in);
+	int32_t latitude_e7, longitude_e7, x, y;
+	int32_t* vertices;
+	uint32_t new_capacity, edge_total;
+	uint8_t integer_input;
+
+	for (i = 0; i < set->count; i++){
+		if (set->polygons[i].id == id){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Geofence ID already in use"));
+		}
+	}
+
+	integer_input = mp_get_buffer(vertices_in, &buffer, MP_BUFFER_READ) && ((buffer.typecode == 'i') || (buffer.typecode == 'l'));
+	if (integer_input){
+		vertex_count = buffer.len / (2*sizeof(int32_t));
+	}
+	else {
+		mp_obj_get_array(vertices_in, &vertex_count, &items);
+	}
+
+	if ((vertex_count < 3) || (vertex_count > UINT16_MAX)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Geofence needs between 3 and 65535 vertices"));
+	}
+
+	if (set->vertex_count + vertex_count > set->vertex_capacity){
+		new_capacity = 2*(set->vertex_count + vertex_count);
+		set->vertices = m_renew(int32_t, set->vertices, 2*set->vertex_capacity, 2*new_capacity);
+		set->vertex_capacity = new_capacity;
+	}
+	vertices = set->vertices + 2*set->vertex_count;
+
+	for (i = 0; i < vertex_count; i++){
+		if (integer_input){
+			latitude_e7 = ((int32_t*)(buffer.buf))[2*i];
+			longitude_e7 = ((int32_t*)(buffer.buf))[2*i + 1];
+		}
+		else {
+			mp_obj_get_array_fixed_n(items[i], 2, &pair);
+			latitude_e7 = mp_obj_get_float(pair[0]) * 1e7f;
+			longitude_e7 = mp_obj_get_float(pair[1]) * 1e7f;
+		}
+
+		// The first vertex of the first geofence becomes the origin of the local plane
+		if ((set->count == 0) && (i == 0)){
+			set->origin_latitude_e7 = latitude_e7;
+			set->origin_longitude_e7 = longitude_e7;
+			set->origin_lon_mm_per_degree = MM_PER_DEGREE * cosf(latitude_e7 / 1e7f * DEG_TO_RAD);
+
+			if (set->origin_lon_mm_per_degree < 1000){
+				set->origin_lon_mm_per_degree = 1000;
+			}
+		}
+
+		if (geofence_project(set, latitude_e7, longitude_e7, &x, &y) != 1){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Geofence vertex too far from the first geofence"));
+		}
+
+		vertices[2*i] = x;
+		vertices[2*i + 1] = y;
+	}
+
+	if (set->count == set->capacity){
+		new_capacity = (set->capacity == 0) ? 8 : 2*set->capacity;
+		set->polygons = m_renew(geofence_polygon_t, set->polygons, set->capacity, new_capacity);
+		set->capacity = new_capacity;
+	}
+
+	polygon = &(set->polygons[set->count]);
+	polygon->id = id;
+	polygon->first_vertex = set->vertex_count;
+	polygon->vertex_count = vertex_count;
+	polygon->inside = 0;
+	edge_total = geofence_prepare(set, polygon);
+
+	// Making room in the shared pools for the polygon's edge index
+	if (set->offset_count + polygon->bucket_count + 1 > set->offset_capacity){
+		new_capacity = 2*(set->offset_count + polygon->bucket_count + 1);
+		set->bucket_offsets = m_renew(uint32_t, set->bucket_offsets, set->offset_capacity, new_capacity);
+		set->offset_capacity = new_capacity;
+	}
+
+	if (set->edge_count + edge_total > set->edge_capacity){
+		new_capacity = 2*(set->edge_count + edge_total);
+		set->bucket_edges = m_renew(uint16_t, set->bucket_edges, set->edge_capacity, new_capacity);
+		set->edge_capacity = new_capacity;
+	}
+
+	set->vertex_count += vertex_count;
+	geofence_build_index(set, polygon);
+	set->count++;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_3(neo_m8_geofence_add_obj, geofence_add);
+
+mp_obj_t geofence_check(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * With no arguments, returns the geofence events since the last call as a list of (ID, entered) tuples, oldest first
+	 * Events come from every new fix read by position()/altitude()/getdata() - entered is True when the fix moved inside the geofence, False when it left
+	 * With a latitude and longitude (degrees), returns a list of the IDs of the geofences containing that point instead
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	geofence_set_t* set = &(self->geofences);
+	geofence_event_t* event;
+	mp_obj_t output = mp_obj_new_list(0, NULL);
+	int32_t x, y;
+	uint16_t i;
+
+	if (n_args == 3){
+		if (set->count == 0){
+			return output;
+		}
+
+		if (geofence_project(set, mp_obj_get_float(args[1]) * 1e7f, mp_obj_get_float(args[2]) * 1e7f, &x, &y) != 1){
+			return output;
+		}
+
+		for (i = 0; i < set->count; i++){
+			if (geofence_contains(set, &(set->polygons[i]), x, y)){
+				mp_obj_list_append(output, mp_obj_new_int(set->polygons[i].id));
+			}
+		}
+
+		return output;
+	}
+
+	while (set->event_count > 0){
+		event = &(set->events[set->event_head]);
+		mp_obj_list_append(output, mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_int(event->id), mp_obj_new_bool(event->entered)}));
+
+		set->event_head = (set->event_head + 1) % GEOFENCE_EVENT_LENGTH;
+		set->event_count--;
+	}
+
+	return output;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_geofence_check_obj, 1, 3, geofence_check);
+
+mp_obj_t geofence_clear(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Removes every geofence and any pending events, and frees their memory
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	geofence_set_t* set = &(self->geofences);
+
+	m_del(geofence_polygon_t, set->polygons, set->capacity);
+	m_del(int32_t, set->vertices, 2*set->vertex_capacity);
+	m_del(uint32_t, set->bucket_offsets, set->offset_capacity);
+	m_del(uint16_t, set->bucket_edges, set->edge_capacity);
+	memset(set, 0, sizeof(geofence_set_t));
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_geofence_clear_obj, geofence_clear);
+
+mp_obj_t distances_to(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Fills an output array with the distance (m) from the last fix (from position()/getdata()) to each point in a pair of latitude/longitude arrays (degrees)
+	 * The arrays must all be array('f') or all array('d'). Uses the haversine formula on a spherical earth (within ~0.5%),
+	 * or Vincenty's formula on the WGS84 ellipsoid if the fourth argument is True - much slower, but accurate at any distance
+	 * Returns the output array, or raises RuntimeError if there hasn't been a fix yet
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	mp_buffer_info_t buffers[3];
+	size_t count = batch_buffers(args + 1, buffers);
+	double latitude = self->data.latitude_e7 / 1e7;
+	double longitude = self->data.longitude_e7 / 1e7;
+	double target_latitude, target_longitude, distance;
+	size_t i;
+
+	if (self->data.fix_utc_us == 0){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("No fix to measure distances from"));
+	}
+
+	if ((n_args == 5) && mp_obj_is_true(args[4])){
+		for (i = 0; i < count; i++){
+			target_latitude = (buffers[0].typecode == 'f') ? ((float*)(buffers[0].buf))[i] : ((double*)(buffers[0].buf))[i];
+			target_longitude = (buffers[0].typecode == 'f') ? ((float*)(buffers[1].buf))[i] : ((double*)(buffers[1].buf))[i];
+			distance = vincenty_distance(latitude, longitude, target_latitude, target_longitude);
+
+			// Falling back to the great-circle distance if Vincenty doesn't converge
+			if (distance < 0){
+				haversine_double(latitude, longitude, &target_latitude, &target_longitude, &distance, 1);
+			}
+
+			if (buffers[0].typecode == 'f'){
+				((float*)(buffers[2].buf))[i] = distance;
+			}
+			else {
+				((double*)(buffers[2].buf))[i] = distance;
+			}
+		}
+	}
+	else if (buffers[0].typecode == 'f'){
+		haversine_float(latitude, longitude, buffers[0].buf, buffers[1].buf, buffers[2].buf, count);
+	}
+	else {
+		haversine_double(latitude, longitude, buffers[0].buf, buffers[1].buf, buffers[2].buf, count);
+	}
+
+	return args[3];
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_distances_to_obj, 4, 5, distances_to);
+
+mp_obj_t bearings_to(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Fills an output array with the initial bearing (degrees clockwise from north, 0-360) from the last fix to each point
+	 * in a pair of latitude/longitude arrays (degrees). The arrays must all be array('f') or all array('d')
+	 * Returns the output array, or raises RuntimeError if there hasn't been a fix yet
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	mp_buffer_info_t buffers[3];
+	size_t count = batch_buffers(args + 1, buffers);
+
+	if (self->data.fix_utc_us == 0){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("No fix to measure bearings from"));
+	}
+
+	if (buffers[0].typecode == 'f'){
+		bearing_float(self->data.latitude_e7 / 1e7f, self->data.longitude_e7 / 1e7f, buffers[0].buf, buffers[1].buf, buffers[2].buf, count);
+	}
+	else {
+		bearing_double(self->data.latitude_e7 / 1e7, self->data.longitude_e7 / 1e7, buffers[0].buf, buffers[1].buf, buffers[2].buf, count);
+	}
+
+	return args[3];
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_bearings_to_obj, 4, 4, bearings_to);
+
+mp_obj_t set_origin(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Sets the origin of the local tangent plane - latitude, longitude (degrees) and height above the WGS84 ellipsoid (m) - or the last fix
+	 * if none is given, raising RuntimeError if there hasn't been one
+	 * From then on, every fix read by position()/altitude()/getdata() is also projected to east/north/up (see enu_into())
+	 * The Kalman filter works in this frame too, so setting a new origin resets it
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+
+	if (n_args == 1){
+		if (self->data.fix_utc_us == 0){
+			mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("No fix to set the origin from"));
+		}
+		enu_set_origin(&(self->enu), self->data.latitude_e7 / 1e7, self->data.longitude_e7 / 1e7, fix_height_mm(self) / 1000.0);
+	}
+	else if (n_args == 4){
+		enu_set_origin(&(self->enu), mp_obj_get_float(args[1]), mp_obj_get_float(args[2]), mp_obj_get_float(args[3]));
+	}
+	else {
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("set_origin() takes no arguments, or latitude, longitude and altitude"));
+	}
+
+	if (self->data.fix_utc_us != 0){
+		enu_update(self);
+	}
+	self->kalman.initialised = 0;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_set_origin_obj, 1, 4, set_origin);
+
+mp_obj_t enu_into(mp_obj_t self_in, mp_obj_t buffer_in){
+	/**
+	 * Micropython-exposed function
+	 * Fills an array('i') of at least 3 items with the last fix's [east, north, up] position (mm) relative to the set_origin() origin
+	 * Doesn't allocate any memory. Returns the array, or None (leaving it alone) if no origin has been set
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	mp_buffer_info_t buffer;
+	int32_t* output;
+
+	mp_get_buffer_raise(buffer_in, &buffer, MP_BUFFER_WRITE);
+
+	if ((buffer.typecode != 'i') && (buffer.typecode != 'l')){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('i')"));
+	}
+	if (buffer.len < 3*sizeof(int32_t)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 3 items"));
+	}
+
+	if (!self->enu.enabled){
+		return mp_const_none;
+	}
+
+	output = buffer.buf;
+	output[0] = self->enu.east_mm;
+	output[1] = self->enu.north_mm;
+	output[2] = self->enu.up_mm;
+
+	return buffer_in;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_enu_into_obj, enu_into);
+
+mp_obj_t kalman(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Turns the on-device Kalman filter on (True) or off (False), optionally setting its process noise - the expected
+	 * acceleration in m/s^2 (default 2). Turning it on resets it. It works in the set_origin() frame - if no origin is set, the next fix becomes it
+	 * The filter fuses every fix read by position()/altitude()/getdata() and every velocity read by velocity()/getdata()
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	mp_float_t acceleration_noise = (n_args == 3) ? mp_obj_get_float(args[2]) : KALMAN_DEFAULT_ACCELERATION_NOISE;
+
+	// Checked before anything changes, so a bad value leaves the filter as it was
+	if (acceleration_noise <= 0){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Process noise must be positive"));
+	}
+
+	self->kalman.enabled = mp_obj_is_true(args[1]);
+	self->kalman.initialised = 0;
+	self->kalman.acceleration_noise = acceleration_noise;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_kalman_obj, 2, 3, kalman);
+
+mp_obj_t filtered_state(mp_obj_t self_in, mp_obj_t buffer_in){
+	/**
+	 * Micropython-exposed function
+	 * Fills an array('f') with the Kalman filter's latest state, in meters and m/s in the local east/north/up frame (see set_origin()):
+	 * [east, north, up, velocity east, velocity north, velocity up], followed by the 1 sigma position uncertainties
+	 * [east, north, up] if the array holds at least 9 items. Doesn't allocate any memory
+	 * Returns False (and leaves the array alone) if the filter is off or hasn't had a fix yet, otherwise True
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	kalman_t* filter = &(self->kalman);
+	mp_buffer_info_t buffer;
+	float* output;
+	uint8_t i;
+
+	mp_get_buffer_raise(buffer_in, &buffer, MP_BUFFER_WRITE);
+
+	if (buffer.typecode != 'f'){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('f')"));
+	}
+	if (buffer.len < 6*sizeof(float)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 6 items"));
+	}
+
+	if (!filter->enabled || !filter->initialised){
+		return mp_const_false;
+	}
+
+	output = (float*)(buffer.buf);
+
+	for (i = 0; i < 3; i++){
+		output[i] = filter->axes[i].position;
+		output[i+3] = filter->axes[i].velocity;
+
+		if (buffer.len >= 9*sizeof(float)){
+			output[i+6] = sqrtf(filter->axes[i].p00);
+		}
+	}
+
+	return mp_const_true;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_filtered_state_obj, filtered_state);
+
+mp_obj_t timestamp(mp_obj_t self_in){
+	/**
+	 * Function to return GPS time/date stamp as a string - formatting helper, the other methods return the time as an integer
+	 * Formatted as "{YYYY-MM-DD}T{hh:mm:ss.sss}Z"
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+    int8_t err;
+	char timestamp[25];
+
+    err = parse_rmc(self);
+
+    // Checking for errors
+    if (err != 1){
+        return mp_obj_new_str("2000-01-01T00:00:00.000Z", 24);
+    }
+
+	format_timestamp(self->data.time.utc_us, timestamp);
+
+	return mp_obj_new_str(timestamp, 24);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_timestamp_obj, timestamp);
+
+mp_obj_t gps_time(mp_obj_t self_in){
+	/**
+	 * Function to return GPS time: (GPS week number, time of week in milliseconds)
+	 * Uses the leap seconds reported by the receiver, or GPS_LEAP_SECONDS until it has reported them
+	 * Returns None if the time/date couldn't be read
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	uint16_t week;
+	uint32_t time_of_week_ms;
+
+    if (parse_rmc(self) != 1){
+		return mp_const_none;
+	}
+
+	utc_to_gps_time(self->data.time.utc_us, self->leap_seconds, &week, &time_of_week_ms);
+
+	return mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_int(week), mp_obj_new_int_from_uint(time_of_week_ms)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gps_time_obj, gps_time);
+
+mp_obj_t gps_time_now(mp_obj_t self_in){
+	/**
+	 * Function to return the current UTC time, as microseconds since 1970-01-01, for timestamping other sensors
+	 * With a PPS pin, this is interpolated from the last timepulse edge (microsecond resolution, tracks the edges
+	 * even when the sentences aren't being read). Otherwise, it's interpolated from when the last GGA/RMC arrived,
+	 * which is only accurate to the UART latency (tens of milliseconds)
+	 * Returns 0 if no time has been received yet
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+
+	update_buffer_internal(self);
+
+	return mp_obj_new_int_from_ll(utc_now_us(self));
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gps_time_now_obj, gps_time_now);
+
+mp_obj_t satellites(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns the satellites in view as a tuple: (count, PRN, elevation, azimuth, C/N0, talker)
+	 * PRN/elevation (degrees, 255 if unknown)/C/N0 (dBHz, 0 if not tracked)/talker are uint8 arrays, azimuth (degrees, -1 if unknown) is an int16 array
+	 * Talker: 0=GPS/SBAS, 1=GLONASS, 2=Galileo, 3=BeiDou, 4=QZSS, 5=combined
+	 * The arrays are memoryviews straight onto the driver's satellite table, so nothing is copied - they change as new GSV sentences arrive
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	gsv_table_t* table = &(self->satellites);
+
+	update_buffer_internal(self);
+
+	return mp_obj_new_tuple(6, (mp_obj_t[6]){mp_obj_new_int(table->count),
+	                                         mp_obj_new_memoryview('B', table->count, table->prn),
+	                                         mp_obj_new_memoryview('B', table->count, table->elevation),
+	                                         mp_obj_new_memoryview('h', table->count, table->azimuth),
+	                                         mp_obj_new_memoryview('B', table->count, table->cno),
+	                                         mp_obj_new_memoryview('B', table->count, table->talker)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_satellites_obj, satellites);
+
+mp_obj_t set_sentence_filter(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Sets which NMEA sentences are let through the framing layer, e.g. set_sentence_filter(["GGA", "RMC", "GSA"])
+	 * Sentences not on the list are dropped as they arrive, before taking up any buffer space. Passing None removes the filter
+	 * GSV sentences are decoded straight into the satellite table, so "GSV" must be in the list for satellites() to work
+	 * If the optional second argument is True, UBX-CFG-MSG is also sent to stop the module outputting the standard sentences not on the list
+	 * Returns None if the module isn't being configured, otherwise 1 if all the ACKs were received, 0 if a NACK was received, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	size_t sentence_count, name_length, i;
+	mp_obj_t *sentences;
+	const char* name;
+	uint32_t filter = 0;
+	int8_t index, flag;
+
+	if (args[1] == mp_const_none){
+		self->sentence_filter = NMEA_FILTER_ALL;
+		return mp_const_none;
+	}
+
+	mp_obj_get_array(args[1], &sentence_count, &sentences);
+
+	for (i = 0; i < sentence_count; i++){
+		name = mp_obj_str_get_data(sentences[i], &name_length);
+		index = message_lookup(name, name_length);
+
+		if (index == -1){
+			mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Unknown NMEA sentence: %s"), name);
+		}
+
+		filter |= 1UL << index;
+	}
+
+	self->sentence_filter = filter;
+
+	if ((n_args < 3) || !mp_obj_is_true(args[2])){
+		return mp_const_none;
+	}
+
+	// UBX-CFG-MSG: Setting the output rate of every standard NMEA sentence not on the list to 0
+	for (i = 0; i < NMEA_MESSAGE_COUNT; i++){
+		if ((filter & (1UL << i)) || (nmea_messages[i].msg_class != 0xF0)){
+			continue;
+		}
+
+		uint8_t payload[3] = {nmea_messages[i].msg_class, nmea_messages[i].msg_id, 0x00};
+		ubx_write_packet(self, 0x06, 0x01, payload, 3);
+
+		// Checking for ACK/NACK, returning if no ACK found
+		flag = ubx_ack_nack(self, 0x06, 0x01);
+
+		if (flag != 1){
+			return mp_obj_new_int(flag);
+		}
+	}
+
+	return mp_obj_new_int(1);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_set_sentence_filter_obj, 2, 3, set_sentence_filter);
+
+mp_obj_t set_message_rate(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Sets how often the module outputs a message, using UBX-CFG-MSG
+	 * Called as set_message_rate(name, rate), e.g. set_message_rate("GSV", 5), or set_message_rate(class, id, rate) for any message
+	 * The rate is a divisor of the navigation rate - 1 outputs it every navigation solution, 5 every 5th one and 0 turns it off
+	 * It can be a single number (applied to the UART the driver is using), or a list of up to 6 rates for the module's ports: [I2C, UART1, UART2, USB, SPI, reserved]
+	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	const message_id_t* message;
+	const char* name;
+	size_t name_length, rate_count, i;
+	mp_obj_t rate_in, *rates;
+	mp_int_t rate;
+	uint8_t payload[8];
+	uint16_t payload_length;
+
+	if (n_args == 3){
+		name = mp_obj_str_get_data(args[1], &name_length);
+		message = find_message(name, name_length);
+
+		if (message == NULL){
+			mp_raise_msg_varg(&mp_type_ValueError, MP_ERROR_TEXT("Unknown message: %s"), name);
+		}
+
+		payload[0] = message->msg_class;
+		payload[1] = message->msg_id;
+		rate_in = args[2];
+	}
+	else {
+		payload[0] = mp_obj_get_int(args[1]);
+		payload[1] = mp_obj_get_int(args[2]);
+		rate_in = args[3];
+	}
+
+	if (mp_obj_is_int(rate_in)){
+		// Short form of UBX-CFG-MSG - sets the rate on the port the message is received on
+		rates = &rate_in;
+		rate_count = 1;
+		payload_length = 3;
+	}
+	else {
+		// Long form of UBX-CFG-MSG - sets the rate on all 6 ports, any not given are set to 0
+		mp_obj_get_array(rate_in, &rate_count, &rates);
+
+		if (rate_count > 6){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Rates can only be given for up to 6 ports"));
+		}
+		payload_length = 8;
+	}
+
+	for (i = 0; i < payload_length - 2; i++){
+		rate = (i < rate_count) ? mp_obj_get_int(rates[i]) : 0;
+
+		if ((rate < 0) || (rate > 255)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid message rate. Rate must be between 0 and 255."));
+		}
+		payload[i+2] = rate;
+	}
+
+	ubx_write_packet(self, 0x06, 0x01, payload, payload_length);
+
+	return mp_obj_new_int(ubx_ack_nack(self, 0x06, 0x01));
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_set_message_rate_obj, 3, 4, set_message_rate);
+
+mp_obj_t gnss_stop(mp_obj_t self_in){
+	/**
+	 * Function to softly shut down the NEO-M8's GNSS systems
+	 * Can be used for power saving as well as just turning it off
+	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	int8_t flag, bytes_written;
+
+	// Defining the UBX-CFG-RST packet to send
+	// Doesn't need to be in error catching, but needs write_method to be defined
+	uint8_t packet[12] = {0xB5, 0x62, 0x06, 0x04, 0x04, 0x00, 0x00, 0x00, 0x08, 0x00, 0x16, 0x74};
+
+	// The module goes quiet while stopped, which isn't something for the watchdog to fix
+	self->watchdog.paused = 1;
+
+	// Sending the UBX packet
+	bytes_written = uart_write_bytes(self->uart_number, packet, 12);
+	flag = ubx_ack_nack(self, packet[2], packet[3]);
+
+	if (bytes_written != 12){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	}
+
+	return mp_obj_new_int(flag);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gnss_stop_obj, gnss_stop);
+
+mp_obj_t gnss_start(mp_obj_t self_in){
+	/**
+	 * Function to start up the NEO-M8's GNSS systems
+	 * To be used to start the module up again after calling gnss_stop()
+	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	int8_t flag, bytes_written;
+
+	// Defining the UBX-CFG-RST packet to send
+	// Doesn't need to be in error catching, but needs write_method to be defined
+	uint8_t packet[12] = {0xB5, 0x62, 0x06, 0x04, 0x04, 0x00, 0x00, 0x00, 0x09, 0x00, 0x17, 0x76};
+
+	// Timing this start for startup_profile() - the UART is already up
+	profile_start(self, esp_timer_get_time(), 1);
+	profile_milestone(self, MILESTONE_UART_UP, self->profile.start_us);
+
+	self->watchdog.paused = 0;
+	self->watchdog.last_byte_us = self->profile.start_us;
+
+	// Sending the UBX packet
+	bytes_written = uart_write_bytes(self->uart_number, packet, 12);
+	flag = ubx_ack_nack(self, packet[2], packet[3]);
+
+	if (bytes_written != 12){
+		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	}
+
+	return mp_obj_new_int(flag);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gnss_start_obj, gnss_start);
+
+mp_obj_t set_power_mode(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Sets the receiver's power mode with UBX-CFG-PM2 and UBX-CFG-RXM:
+	 * 0 - continuous (full power), 1 - cyclic tracking, 2 - ON/OFF
+	 * In the power save modes, the receiver works out a fix every update_period_ms (default 1000), retries acquisition every
+	 * search_period_ms (default 10000) if it can't get one, and in ON/OFF mode stays on for on_time seconds (default 0) after each fix
+	 * Returns 1 if both messages were ACKed, 0 if one was NACKed, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	uint8_t mode = mp_obj_get_int(args[1]);
+	uint32_t update_period_ms = (n_args > 2) ? mp_obj_get_int(args[2]) : 1000;
+	uint32_t search_period_ms = (n_args > 3) ? mp_obj_get_int(args[3]) : 10000;
+	uint16_t on_time = (n_args > 4) ? mp_obj_get_int(args[4]) : 0;
+	uint32_t flags;
+	uint8_t pm2[44] = {0};
+	uint8_t rxm[2] = {0x08, 0x00};
+	int8_t flag;
+
+	if (mode > POWER_MODE_ON_OFF){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Power mode must be 0 (continuous), 1 (cyclic) or 2 (ON/OFF)"));
+	}
+
+	if (mode != POWER_MODE_CONTINUOUS){
+		if ((update_period_ms == 0) || (search_period_ms == 0)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Update and search periods must be positive"));
+		}
+
+		// Mode in bits 17-18 (0 = ON/OFF, 1 = cyclic tracking), and updateEPH so ephemeris is kept up to date between fixes
+		flags = (1 << 12) | (((mode == POWER_MODE_CYCLIC) ? 1 : 0) << 17);
+
+		// UBX-CFG-PM2 version 1 - everything not set here is reserved or left at 0
+		pm2[0] = 0x01;
+		pm2[4] = flags & 0xFF;
+		pm2[5] = (flags >> 8) & 0xFF;
+		pm2[6] = (flags >> 16) & 0xFF;
+		pm2[7] = flags >> 24;
+		pm2[8] = update_period_ms & 0xFF;
+		pm2[9] = (update_period_ms >> 8) & 0xFF;
+		pm2[10] = (update_period_ms >> 16) & 0xFF;
+		pm2[11] = update_period_ms >> 24;
+		pm2[12] = search_period_ms & 0xFF;
+		pm2[13] = (search_period_ms >> 8) & 0xFF;
+		pm2[14] = (search_period_ms >> 16) & 0xFF;
+		pm2[15] = search_period_ms >> 24;
+		pm2[20] = on_time & 0xFF;
+		pm2[21] = on_time >> 8;
+
+		ubx_write_packet(self, 0x06, 0x3B, pm2, 44);
+		flag = ubx_ack_nack(self, 0x06, 0x3B);
+
+		if (flag != 1){
+			return mp_obj_new_int(flag);
+		}
+
+		// lpMode 1 - power save mode
+		rxm[1] = 0x01;
+	}
+
+	ubx_write_packet(self, 0x06, 0x11, rxm, 2);
+	flag = ubx_ack_nack(self, 0x06, 0x11);
+
+	if (flag == 1){
+		self->power_mode = mode;
+		self->update_period_ms = (mode == POWER_MODE_CONTINUOUS) ? 0 : update_period_ms;
+	}
+
+	return mp_obj_new_int(flag);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_set_power_mode_obj, 2, 5, set_power_mode);
+
+mp_obj_t power_sleep(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * In the power save modes, light-sleeps the ESP32 until just before the receiver's next output is due - guard_ms (default 50)
+	 * before one update period after the last GGA/RMC arrived - so UART servicing lines up with the receiver's ON windows
+	 * The UART can't receive during light sleep, so where the chip supports it (UART1, not UART2, on the ESP32) the module starting to
+	 * send also wakes it - the characters that wake it are lost, so the sentence they were part of fails its checksum and is dropped
+	 * Returns the number of ms slept - 0 if the next output is already due, or the receiver is in continuous mode
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	int64_t guard_us = 1000 * ((n_args == 2) ? mp_obj_get_int(args[1]) : POWER_DEFAULT_GUARD_MS);
+	int64_t sleep_us, start_us;
+	uint8_t uart_wakeup;
+
+	if ((self->power_mode == POWER_MODE_CONTINUOUS) || (self->time_received_us == 0)){
+		return mp_obj_new_int(0);
+	}
+
+	sleep_us = self->time_received_us + 1000*(int64_t)(self->update_period_ms) - guard_us - esp_timer_get_time();
+
+	if (sleep_us < 1000){
+		return mp_obj_new_int(0);
+	}
+
+	esp_sleep_enable_timer_wakeup(sleep_us);
+	uart_wakeup = (uart_set_wakeup_threshold(self->uart_number, POWER_UART_WAKEUP_EDGES) == ESP_OK) &&
+	              (esp_sleep_enable_uart_wakeup(self->uart_number) == ESP_OK);
+
+	start_us = esp_timer_get_time();
+	esp_light_sleep_start();
+	sleep_us = esp_timer_get_time() - start_us;
+
+	if (uart_wakeup){
+		esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_UART);
+	}
+
+	return mp_obj_new_int(sleep_us / 1000);
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_power_sleep_obj, 1, 2, power_sleep);
+
+mp_obj_t save_navdb(mp_obj_t self_in, mp_obj_t path){
+	/**
+	 * Micropython-exposed function
+	 * Polls the module's navigation database (ephemeris, almanac, etc.) with UBX-MGA-DBD and saves it to a file
+	 * Finishes once the module has gone quiet for 1s. Returns the number of messages saved
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	mp_obj_t file = mp_call_function_2(MP_OBJ_FROM_PTR(&mp_builtin_open_obj), path, MP_OBJ_NEW_QSTR(MP_QSTR_wb));
+	uint8_t empty[1];
+	int64_t start_time, now;
+	nlr_buf_t nlr;
+
+	self->navdb_count = 0;
+	self->navdb_error = 0;
+	self->navdb_file = file;
+
+	// Anything raised while the database is arriving (a UART or recorder error) mustn't leave the framing layer writing to the file
+	if (nlr_push(&nlr) == 0){
+		ubx_write_packet(self, 0x13, 0x80, empty, 0);
+		start_time = esp_timer_get_time();
+
+		// The module sends the database as a burst of MGA-DBD messages, which the framing layer saves as they arrive
+		while (self->navdb_error == 0){
+			update_buffer_internal(self);
+			now = esp_timer_get_time();
+
+			if ((self->navdb_count == 0) ? (now - start_time > NAVDB_START_TIMEOUT_US) : (now - self->navdb_last_us > NAVDB_IDLE_TIMEOUT_US)){
+				break;
+			}
+		}
+
+		nlr_pop();
+	}
+	else {
+		self->navdb_file = MP_OBJ_NULL;
+		mp_stream_close(file);
+		nlr_jump(nlr.ret_val);
+	}
+
+	self->navdb_file = MP_OBJ_NULL;
+	mp_stream_close(file);
+
+	if (self->navdb_error != 0){
+		mp_raise_OSError(self->navdb_error);
+	}
+
+	return mp_obj_new_int(self->navdb_count);
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_save_navdb_obj, save_navdb);
+
+mp_obj_t restore_navdb(mp_obj_t self_in, mp_obj_t path){
+	/**
+	 * Micropython-exposed function
+	 * Sends a navigation database saved by save_navdb() back to the module, one message at a time - each waits for the
+	 * module's UBX-MGA-ACK before the next is sent, so its input buffer can't overflow (or a fixed pause, if acknowledgements couldn't be turned on)
+	 * Returns (messages accepted, messages rejected, messages not acknowledged)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	mp_obj_t file = mp_call_function_2(MP_OBJ_FROM_PTR(&mp_builtin_open_obj), path, MP_OBJ_NEW_QSTR(MP_QSTR_rb));
+	uint8_t frame[UBX_MAX_PAYLOAD_LENGTH + 8];
+	uint16_t length, counts[3] = {0, 0, 0};
+	uint8_t acked;
+	int8_t result;
+	nlr_buf_t nlr;
+
+	// Anything raised while sending (a file read, UART or recorder error) mustn't leave the file open
+	if (nlr_push(&nlr) == 0){
+		acked = mga_enable_ack(self);
+
+		while ((result = ubx_file_read_frame(file, frame, &length)) == 1){
+			switch (mga_send_acked(self, frame, length, acked)){
+				case 1:
+					counts[0]++;
+					break;
+				case 0:
+					counts[1]++;
+					break;
+				default:
+					counts[2]++;
+			}
+		}
+
+		nlr_pop();
+	}
+	else {
+		mp_stream_close(file);
+		nlr_jump(nlr.ret_val);
+	}
+
+	mp_stream_close(file);
+
+	if (result == -1){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Corrupt navigation database file"));
+	}
+
+	return mp_obj_new_tuple(3, (mp_obj_t[3]){mp_obj_new_int(counts[0]), mp_obj_new_int(counts[1]), mp_obj_new_int(counts[2])});
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_restore_navdb_obj, restore_navdb);
+
+mp_obj_t load_assistnow(mp_obj_t self_in, mp_obj_t path){
+	/**
+	 * Micropython-exposed function
+	 * Streams a pre-downloaded AssistNow Offline file (UBX-MGA-ANO messages) to the module a message at a time, without loading it into memory
+	 * Each message waits for the module's UBX-MGA-ACK (or a fixed pause, if acknowledgements couldn't be turned on) before the next is sent. If today's date is known (from the module
+	 * or the RTC memory), only today's ANO messages are sent - the module can only use the current day's
+	 * Returns (time taken in ms, messages accepted, messages rejected or not acknowledged, messages skipped)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	mp_obj_t file = mp_call_function_2(MP_OBJ_FROM_PTR(&mp_builtin_open_obj), path, MP_OBJ_NEW_QSTR(MP_QSTR_rb));
+	uint8_t frame[UBX_MAX_PAYLOAD_LENGTH + 8];
+	uint16_t length, accepted = 0, rejected = 0, skipped = 0;
+	int64_t start_time = esp_timer_get_time();
+	int32_t today;
+	uint8_t acked;
+	int8_t result;
+	nlr_buf_t nlr;
+
+	// Anything raised while sending (a file read, UART or recorder error) mustn't leave the file open
+	if (nlr_push(&nlr) == 0){
+		acked = mga_enable_ack(self);
+		today = utc_today(self);
+
+		while ((result = ubx_file_read_frame(file, frame, &length)) == 1){
+			// UBX-MGA-ANO - the date is at payload offsets 4-6, year since 2000
+			if ((today != -1) && (frame[2] == 0x13) && (frame[3] == 0x20) && (length == 84) &&
+			    (days_from_civil(2000 + frame[10], frame[11], frame[12]) != today)){
+				skipped++;
+				continue;
+			}
 
-	return mp_const_none;
+			if (mga_send_acked(self, frame, length, acked) == 1){
+				accepted++;
+			}
+			else {
+				rejected++;
+			}
+		}
+
+		nlr_pop();
+	}
+	else {
+		mp_stream_close(file);
+		nlr_jump(nlr.ret_val);
+	}
+
+	mp_stream_close(file);
+
+	if (result == -1){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Corrupt AssistNow file"));
+	}
+
+	return mp_obj_new_tuple(4, (mp_obj_t[4]){mp_obj_new_int((esp_timer_get_time() - start_time) / 1000),
+	                                         mp_obj_new_int(accepted), mp_obj_new_int(rejected), mp_obj_new_int(skipped)});
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_update_buffer_obj, update_buffer);
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_load_assistnow_obj, load_assistnow);
 
-mp_obj_t position(mp_obj_t self_in){
+mp_obj_t aid(mp_obj_t self_in){
 	/**
 	 * Micropython-exposed function
-	 * Returns location data: latitude, longitude, position error, timestamp
-	 *                    |degrees/decimal minutes|    meters    | GMT hh:mm:ss
+	 * Sends the module the time and position of the last good fix from before the ESP32 deep slept or reset (kept in RTC memory),
+	 * with accuracy estimates, so it can skip most of its search. This is also done automatically when the driver is created
+	 * Returns (time sent, position sent)
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    int8_t err;
+	uint8_t sent = rtc_aid(self);
 
-    err = parse_gga(self);
+	self->aided |= sent;
 
-    // Checking for errors
-    if (err != 1){
-		return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_str("0", 1)});
+	return mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_bool(sent & 1), mp_obj_new_bool(sent & 2)});
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_aid_obj, aid);
+
+mp_obj_t ttff_log(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns the time to first fix of the last 16 boots (kept in RTC memory) as a list of (TTFF in ms since the ESP32 booted, aided), oldest first
+	 * Aided is 0 for none, 1 for time only, 2 for position only and 3 for both
+	*/
+	mp_obj_t output = mp_obj_new_list(0, NULL);
+	uint8_t i, index;
+
+	if (rtc_aiding.magic != RTC_AIDING_MAGIC){
+		return output;
 	}
 
-    return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(self->data.latitude),
-                                            mp_obj_new_float(self->data.longitude),
-                                            mp_obj_new_float(self->data.position_error),
-                                            mp_obj_new_str(self->data.timestamp, 8)});
+	for (i = 0; i < rtc_aiding.ttff_count; i++){
+		index = (rtc_aiding.ttff_head + i) % RTC_TTFF_LOG_LENGTH;
+		mp_obj_list_append(output, mp_obj_new_tuple(2, (mp_obj_t[2]){mp_obj_new_int_from_uint(rtc_aiding.ttff_ms[index]),
+		                                                              mp_obj_new_int(rtc_aiding.ttff_aided[index])}));
+	}
+
+	return output;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_position_obj, position);
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_ttff_log_obj, ttff_log);
 
-mp_obj_t velocity(mp_obj_t self_in){
+mp_obj_t startup_profile(size_t n_args, const mp_obj_t *args){
 	/**
 	 * Micropython-exposed function
-	 * Returns velocity and course data - speed over ground (knots), course over ground (degrees), timestamp (GMT hh:mm:ss)
-	 * Course over ground is returned as Python Nonetype if not availible due to speed being too low
+	 * Returns a dict of when each milestone of the latest start was reached, in ms after the start (the ESP32 booting, or gnss_start()),
+	 * or None if it hasn't been yet: "uart_up", "first_byte", "first_nmea", "fix_2d", "fix_3d", "fix_accurate" (first fix within the accuracy threshold)
+	 * "histogram" is a list of (upper limit in s, count) bins of time to first 3D fix over every start since power-up, the last limit being None
+	 * Optionally sets the accuracy threshold in m (default 5), and clears the histogram if the second argument is True
 	*/
-	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    int8_t err;
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	static const qstr names[MILESTONE_COUNT] = {MP_QSTR_uart_up, MP_QSTR_first_byte, MP_QSTR_first_nmea, MP_QSTR_fix_2d, MP_QSTR_fix_3d, MP_QSTR_fix_accurate};
+	mp_obj_t output = mp_obj_new_dict(MILESTONE_COUNT + 1);
+	mp_obj_t histogram = mp_obj_new_list(0, NULL);
+	uint8_t i;
 
-    err = parse_rmc(self);
+	if ((n_args > 1) && (args[1] != mp_const_none)){
+		self->profile.accuracy_threshold_mm = mp_obj_get_float(args[1]) * 1000;
+	}
 
-    // Checking for errors
-    if (err != 1){
-		return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_str("0", 1)});
+	if ((rtc_profile.magic != RTC_PROFILE_MAGIC) || ((n_args > 2) && mp_obj_is_true(args[2]))){
+		memset(&rtc_profile, 0, sizeof(rtc_profile_t));
+		rtc_profile.magic = RTC_PROFILE_MAGIC;
 	}
 
-    if (self->data.cog == -1){
-        return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(self->data.sog),
-                                                mp_const_none,
-                                                mp_obj_new_str(self->data.timestamp, 8)});
-    }
+	for (i = 0; i < MILESTONE_COUNT; i++){
+		mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(names[i]), (self->profile.milestone_us[i] == -1) ? mp_const_none : mp_obj_new_int(self->profile.milestone_us[i] / 1000));
+	}
 
-    return mp_obj_new_list(3, (mp_obj_t[3]){mp_obj_new_float(self->data.sog),
-                                            mp_obj_new_float(self->data.cog),
-                                            mp_obj_new_str(self->data.timestamp, 8)});
+	for (i = 0; i < PROFILE_HISTOGRAM_BINS; i++){
+		mp_obj_list_append(histogram, mp_obj_new_tuple(2, (mp_obj_t[2]){(i < PROFILE_HISTOGRAM_BINS - 1) ? mp_obj_new_int(profile_histogram_limits[i]) : mp_const_none,
+		                                                                mp_obj_new_int(rtc_profile.counts[i])}));
+	}
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_histogram), histogram);
+
+	return output;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_velocity_obj, velocity);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_startup_profile_obj, 1, 3, startup_profile);
 
-mp_obj_t altitude(mp_obj_t self_in){
+mp_obj_t set_watchdog(mp_obj_t self_in, mp_obj_t timeout_in){
 	/**
 	 * Micropython-exposed function
-	 * Returns altitude data - altitude AMSL (meters), geoid separation (meters), vertical error (meters), timestamp (GMT hh:mm:ss)
+	 * Sets how long (ms) the module can go silent before the watchdog tries to recover it (default 5000), or turns the watchdog off if 0
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    int8_t err1, err2;
+	mp_int_t timeout_ms = mp_obj_get_int(timeout_in);
+
+	if (timeout_ms < 0){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Watchdog timeout can't be negative"));
+	}
 
-    err1 = parse_gga(self);
-    err2 = parse_gsa(self);
+	self->watchdog.timeout_ms = timeout_ms;
+	self->watchdog.failures = 0;
+	self->watchdog.last_byte_us = esp_timer_get_time();
 
-    // Checking for errors
-    if ((err1 != 1) || (err2 != 1)){
-		return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_float(0.0f), mp_obj_new_str("0", 1)});
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_set_watchdog_obj, set_watchdog);
+
+mp_obj_t set_baudrate(mp_obj_t self_in, mp_obj_t baud_rate_in){
+	/**
+	 * Micropython-exposed function
+	 * Switches the module's UART1 (UBX-CFG-PRT, 8N1, UBX/NMEA/RTCM in and UBX/NMEA out) and then the ESP32's UART to a new baud rate
+	 * The ESP32's RX buffer is resized to hold about UART_RX_BUFFER_MS of data at the new rate, so it doesn't overflow between reads
+	 * Returns True if the module is heard from at the new rate. If not, the ESP32's UART goes back to the old rate and False is returned
+	 * (the watchdog will still find the module if it did switch)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	mp_int_t baud_rate = mp_obj_get_int(baud_rate_in);
+	uint8_t payload[20] = {0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00, 0, 0, 0, 0, 0x07, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00};
+	uint32_t original_baud_rate;
+	uint16_t buffer_length;
+	esp_err_t err;
+	uint8_t i;
+
+	for (i = 0; i < BAUD_RATE_COUNT; i++){
+		if (baud_rates[i] == baud_rate){
+			break;
+		}
 	}
 
-    return mp_obj_new_list(4, (mp_obj_t[4]){mp_obj_new_float(self->data.altitude),
-                                            mp_obj_new_float(self->data.geosep),
-                                            mp_obj_new_float(self->data.vertical_error),
-                                            mp_obj_new_str(self->data.timestamp, 8)});
+	if (i == BAUD_RATE_COUNT){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Baud rate must be 4800, 9600, 19200, 38400, 57600, 115200, 230400 or 460800"));
+	}
+
+	payload[8] = baud_rate & 0xFF;
+	payload[9] = (baud_rate >> 8) & 0xFF;
+	payload[10] = (baud_rate >> 16) & 0xFF;
+	payload[11] = (baud_rate >> 24) & 0xFF;
+
+	// An explicit change takes over from any recovery attempt in hand, which would otherwise carry on changing the UART's baud rate
+	if (self->watchdog.state != WATCHDOG_IDLE){
+		if (self->watchdog.state == WATCHDOG_PROBING){
+			uart_set_baudrate(self->uart_number, self->watchdog.original_baud_rate);
+		}
+		watchdog_finish(self);
+	}
+
+	// The module switches as soon as it has taken the packet in, so its ACK is usually garbled - the probe afterwards is the check
+	uart_get_baudrate(self->uart_number, &original_baud_rate);
+	ubx_write_packet(self, 0x06, 0x00, payload, sizeof(payload));
+	uart_wait_tx_done(self->uart_number, pdMS_TO_TICKS(200));
+	vTaskDelay(pdMS_TO_TICKS(100));
+
+	// Resizing the RX buffer means reinstalling the driver - the pins and line settings stay configured
+	buffer_length = (baud_rate / 10) * UART_RX_BUFFER_MS / 1000;
+	if (buffer_length < UART_RX_BUFFER_LENGTH){
+		buffer_length = UART_RX_BUFFER_LENGTH;
+	}
+
+	if (buffer_length != self->uart_buffer_length){
+		uart_driver_delete(self->uart_number);
+
+		err = uart_driver_install(self->uart_number, buffer_length, 0, 0, NULL, 0);
+		if (err != ESP_OK){
+			// Putting the driver back as it was (e.g. if there wasn't the memory for the bigger buffer), so the UART still works.
+			// The module may have switched rates - the watchdog will find it again
+			if (uart_driver_install(self->uart_number, self->uart_buffer_length, 0, 0, NULL, 0) != ESP_OK){
+				mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART driver install failed, and the old one couldn't be put back: %s"),
+				                  esp_err_to_name(err));
+			}
+			mp_raise_msg_varg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART driver install failed: %s"), esp_err_to_name(err));
+		}
+		self->uart_buffer_length = buffer_length;
+	}
+
+	uart_set_baudrate(self->uart_number, baud_rate);
+
+	if (watchdog_probe(self)){
+		self->watchdog.last_byte_us = esp_timer_get_time();
+		return mp_const_true;
+	}
+
+	uart_set_baudrate(self->uart_number, original_baud_rate);
+	return mp_const_false;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_altitude_obj, altitude);
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_set_baudrate_obj, set_baudrate);
 
-mp_obj_t getdata(mp_obj_t self_in){
+mp_obj_t health(mp_obj_t self_in){
 	/**
 	 * Micropython-exposed function
-	 * Returns all availible GPS data - latitude, longitude, position error, altitude, vertical error, speed over ground, course over ground, geoid separation, timestamp
-	 * Latitude/longitude: degrees and decimal minutes
-	 * Position error/altitude/vertical error/geoid separation: meters
-	 * Speed over ground: Knots
-	 * Couse over ground: degrees (or Python Nonetype if speed too low to calculate course)
-	 * Timestamp: GMT hh:mm:ss
+	 * Returns a dict of the link's health: "frames" (valid sentences/frames received), "bytes" (bytes read), "garbage" (bytes thrown away),
+	 * "last_frame" (ms since the last valid sentence/frame, None if there hasn't been one), "baud_rate" (the UART's current baud rate),
+	 * "config" (configuration messages cached for re-sending), "recoveries" (recovery attempts), and "events" - a list of the last 8 attempts,
+	 * oldest first, as (ms since boot, "silent" or "garbage", baud rate the module was found at or None, configuration messages re-sent and ACKed)
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	watchdog_t* watchdog = &(self->watchdog);
+	watchdog_event_t* event;
+	mp_obj_t output = mp_obj_new_dict(8);
+	mp_obj_t events = mp_obj_new_list(0, NULL);
+	uint32_t baud_rate = 0;
+	uint8_t i;
 
-    int8_t err1, err2, err3;
+	uart_get_baudrate(self->uart_number, &baud_rate);
 
-    err1 = parse_gga(self);
-    err2 = parse_rmc(self);
-    err3 = parse_gsa(self);
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_frames), mp_obj_new_int_from_uint(watchdog->frame_count));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_bytes), mp_obj_new_int_from_uint(watchdog->byte_count));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_garbage), mp_obj_new_int_from_uint(watchdog->garbage_count));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_last_frame), (watchdog->frame_count == 0) ? mp_const_none :
+	                  mp_obj_new_int((esp_timer_get_time() - watchdog->last_frame_us) / 1000));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_baud_rate), mp_obj_new_int_from_uint(baud_rate));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_config), mp_obj_new_int(watchdog->config_count));
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_recoveries), mp_obj_new_int(watchdog->recoveries));
 
-    // Checking for errors
-    if ((err1 != 1) || (err2 != 1) || (err3 != 1)){
-		return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(0.0f),
-                                                mp_obj_new_float(0.0f),
-												mp_obj_new_float(0.0f),
-                                                mp_obj_new_float(0.0f),
-												mp_obj_new_float(0.0f),
-                                                mp_obj_new_float(0.0f),
-												mp_const_none,
-                                                mp_obj_new_float(0.0f),
-												mp_obj_new_str("0", 1)});
-    }
+	for (i = 0; i < watchdog->event_count; i++){
+		event = &(watchdog->events[(watchdog->event_head + WATCHDOG_EVENT_LENGTH - watchdog->event_count + i) % WATCHDOG_EVENT_LENGTH]);
 
-    // If the COG is invalid, return none instead
-    if (self->data.cog == -1){
-        return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(self->data.latitude),
-                                                mp_obj_new_float(self->data.longitude),
-                                                mp_obj_new_float(self->data.position_error),
-                                                mp_obj_new_float(self->data.altitude),
-                                                mp_obj_new_float(self->data.vertical_error),
-                                                mp_obj_new_float(self->data.sog),
-                                                mp_const_none,
-                                                mp_obj_new_float(self->data.geosep),
-                                                mp_obj_new_str(self->data.timestamp, 8)});
+		mp_obj_list_append(events, mp_obj_new_tuple(4, (mp_obj_t[4]){mp_obj_new_int(event->time_us / 1000),
+		                                                            MP_OBJ_NEW_QSTR((event->reason == WATCHDOG_SILENT) ? MP_QSTR_silent : MP_QSTR_garbage),
+		                                                            (event->baud_rate == 0) ? mp_const_none : mp_obj_new_int_from_uint(event->baud_rate),
+		                                                            mp_obj_new_int(event->replayed)}));
 	}
+	mp_obj_dict_store(output, MP_OBJ_NEW_QSTR(MP_QSTR_events), events);
 
-    return mp_obj_new_list(9, (mp_obj_t[9]){mp_obj_new_float(self->data.latitude),
-                                            mp_obj_new_float(self->data.longitude),
-                                            mp_obj_new_float(self->data.position_error),
-                                            mp_obj_new_float(self->data.altitude),
-                                            mp_obj_new_float(self->data.vertical_error),
-                                            mp_obj_new_float(self->data.sog),
-                                            mp_obj_new_float(self->data.cog),
-                                            mp_obj_new_float(self->data.geosep),
-                                            mp_obj_new_str(self->data.timestamp, 8)});
+	return output;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_getdata_obj, getdata);
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_health_obj, health);
 
-mp_obj_t timestamp(mp_obj_t self_in){
+mp_obj_t rf_monitor(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Polls UBX-MON-HW every period_ms (0 stops polling) without blocking - the response is picked up by later reads
+	 * The optional callback is called with the driver object when the module flags jamming (jammingState rising to warning or critical),
+	 * which needs interference detection turned on (UBX-CFG-ITFM, as set by modulesetup())
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	mp_int_t period_ms = mp_obj_get_int(args[1]);
+
+	if (period_ms < 0){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Polling period can't be negative"));
+	}
+	if ((n_args == 3) && (args[2] != mp_const_none) && !mp_obj_is_callable(args[2])){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Callback must be callable"));
+	}
+
+	self->rf.poll_period_ms = period_ms;
+	self->rf.polled_us = 0;
+	self->rf.callback = (n_args == 3) ? args[2] : mp_const_none;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_rf_monitor_obj, 2, 3, rf_monitor);
+
+mp_obj_t rf_status(mp_obj_t self_in, mp_obj_t buffer_in){
 	/**
-	 * Function to return GPS time/date stamp
-	 * Formatted as "{YYYY-MM-DD}T{hh:mm:ss}Z"
+	 * Micropython-exposed function
+	 * Fills an array('i') of at least 7 items with the latest UBX-MON-HW RF status:
+	 * [jamInd (0-255 CW jamming indicator), jammingState (0 unknown/disabled, 1 ok, 2 warning, 3 critical), noisePerMS, agcCnt (0-8191),
+	 *  antenna status (0 init, 1 unknown, 2 ok, 3 short, 4 open), antenna power (0 off, 1 on, 2 unknown), ms since it was received]
+	 * Doesn't allocate any memory. Returns the array, or None (leaving it alone) if no UBX-MON-HW has been received yet
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	rf_monitor_t* rf = &(self->rf);
+	mp_buffer_info_t buffer;
+	int32_t* output;
 
-    int8_t err;
-	char timestamp[20] = "2000-01-01T00:00:00Z";
+	mp_get_buffer_raise(buffer_in, &buffer, MP_BUFFER_WRITE);
 
-    err = parse_rmc(self);
+	if ((buffer.typecode != 'i') && (buffer.typecode != 'l')){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('i')"));
+	}
+	if (buffer.len < RF_STATUS_ITEMS*sizeof(int32_t)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 7 items"));
+	}
 
-    // Checking for errors
-    if (err != 1){
-        return mp_obj_new_str(timestamp, 20);
-    }
+	if (rf->received_us == 0){
+		return mp_const_none;
+	}
 
-	// Formatting the date data
-    timestamp[8] = self->data.date[0];
-	timestamp[9] = self->data.date[1];
-	timestamp[5] = self->data.date[2];
-	timestamp[6] = self->data.date[3];
-	timestamp[2] = self->data.date[4];
-	timestamp[3] = self->data.date[5];
+	output = buffer.buf;
+	output[0] = rf->jam_indicator;
+	output[1] = rf->jamming_state;
+	output[2] = rf->noise_per_ms;
+	output[3] = rf->agc_count;
+	output[4] = rf->antenna_status;
+	output[5] = rf->antenna_power;
+	output[6] = (esp_timer_get_time() - rf->received_us) / 1000;
 
-	// Formatting the time data
-    timestamp[11] = self->data.timestamp[0];
-    timestamp[12] = self->data.timestamp[1];
-    timestamp[14] = self->data.timestamp[3];
-    timestamp[15] = self->data.timestamp[4];
-    timestamp[17] = self->data.timestamp[6];
-    timestamp[18] = self->data.timestamp[7];
+	return buffer_in;
+}
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_rf_status_obj, rf_status);
+
+mp_obj_t accuracy(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns the receiver's latest accuracy estimates (1 sigma) as (horizontal (m), vertical (m), speed (m/s), heading (degrees), source, age (ms)),
+	 * where source is 1 for UBX-NAV-PVT, 2 for UBX-NAV-POSLLH and 3 for PUBX,00 - speed and heading are None unless NAV-PVT is being received
+	 * Returns None if no estimates have been received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
+	accuracy_t* accuracy = &(self->accuracy);
+	uint8_t velocity = (accuracy->velocity_received_us != 0);
+
+	if (accuracy->source == ACCURACY_SOURCE_NONE){
+		return mp_const_none;
+	}
 
-	return mp_obj_new_str(timestamp, 20);
+	mp_obj_t accuracy_tuple[6] = {mp_obj_new_float(accuracy->horizontal_mm / 1000.0f),
+	                              mp_obj_new_float(accuracy->vertical_mm / 1000.0f),
+	                              velocity ? mp_obj_new_float(accuracy->speed_mms / 1000.0f) : mp_const_none,
+	                              velocity ? mp_obj_new_float(accuracy->heading_e5 / 1e5f) : mp_const_none,
+	                              mp_obj_new_int(accuracy->source),
+	                              mp_obj_new_int((esp_timer_get_time() - accuracy->received_us) / 1000)};
+
+	return mp_obj_new_tuple(6, accuracy_tuple);
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_timestamp_obj, timestamp);
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_accuracy_obj, accuracy);
 
-mp_obj_t gnss_stop(mp_obj_t self_in){
+mp_obj_t velocity_ned_into(mp_obj_t self_in, mp_obj_t buffer_in){
 	/**
-	 * Function to softly shut down the NEO-M8's GNSS systems
-	 * Can be used for power saving as well as just turning it off
-	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	 * Micropython-exposed function
+	 * Fills an array('i') of at least 6 items with the latest north/east/down velocity:
+	 * [north, east, down (cm/s), speed accuracy (cm/s, -1 if unknown), source (1 UBX-NAV-PVT, 2 UBX-NAV-VELNED, 3 PUBX,00), ms since it was received]
+	 * UBX-NAV-VELNED/NAV-PVT are used as soon as they arrive, so this runs at the navigation rate without reading a fix
+	 * Doesn't allocate any memory. Returns the array, or None (leaving it alone) if there's no velocity yet
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-	int8_t flag, bytes_written;
+	mp_buffer_info_t buffer;
+	int32_t* output;
 
-	// Defining the UBX-CFG-RST packet to send
-	// Doesn't need to be in error catching, but needs write_method to be defined
-	uint8_t packet[12] = {0xB5, 0x62, 0x06, 0x04, 0x04, 0x00, 0x00, 0x00, 0x08, 0x00, 0x16, 0x74};
+	mp_get_buffer_raise(buffer_in, &buffer, MP_BUFFER_WRITE);
 
-	// Sending the UBX packet
-	bytes_written = uart_write_bytes(self->uart_number, packet, 12);
-	flag = ubx_ack_nack(self);
+	if ((buffer.typecode != 'i') && (buffer.typecode != 'l')){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Output buffer must be an array('i')"));
+	}
+	if (buffer.len < VELOCITY_NED_ITEMS*sizeof(int32_t)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Output buffer must hold at least 6 items"));
+	}
 
-	if (bytes_written != 12){
-		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	update_buffer_internal(self);
+
+	if (self->data.velocity_source == VELOCITY_SOURCE_NONE){
+		return mp_const_none;
 	}
 
-	return mp_obj_new_int(flag);
+	output = buffer.buf;
+	output[0] = self->data.velocity_north_cms;
+	output[1] = self->data.velocity_east_cms;
+	output[2] = self->data.velocity_down_cms;
+	output[3] = self->data.speed_accuracy_cms;
+	output[4] = self->data.velocity_source;
+	output[5] = (esp_timer_get_time() - self->data.velocity_received_us) / 1000;
+
+	return buffer_in;
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gnss_stop_obj, gnss_stop);
+static MP_DEFINE_CONST_FUN_OBJ_2(neo_m8_velocity_ned_into_obj, velocity_ned_into);
 
-mp_obj_t gnss_start(mp_obj_t self_in){
+mp_obj_t pubx_mode(size_t n_args, const mp_obj_t *args){
 	/**
-	 * Function to start up the NEO-M8's GNSS systems
-	 * To be used to start the module up again after calling gnss_stop()
-	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	 * Micropython-exposed function
+	 * Turns PUBX,00 mode on/off - when on, position(), velocity(), altitude() and getdata() all run from PUBX,00 rather than GGA/RMC/GSA
+	 * PUBX,00 is polled every poll_period_ms (default 1000, which should match the navigation rate) - 0 doesn't poll, for when the module
+	 * has been set to output it periodically with set_message_rate("PUBX,00", 1)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	mp_int_t poll_period_ms = (n_args == 3) ? mp_obj_get_int(args[2]) : PUBX_DEFAULT_POLL_PERIOD_MS;
+
+	if (poll_period_ms < 0){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Polling period can't be negative"));
+	}
+
+	self->pubx.enabled = mp_obj_is_true(args[1]);
+	self->pubx.poll_period_ms = poll_period_ms;
+	self->pubx.polled_us = 0;
+	self->pubx.pending = 0;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_pubx_mode_obj, 2, 3, pubx_mode);
+
+mp_obj_t fix_policy(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Sets which fixes position()/altitude()/getdata() use, e.g. fix_policy([1, 2], 6, 4.0)
+	 * qualities is a list of accepted GGA quality indicators (1 GPS, 2 DGPS/SBAS, 4/5 RTK fixed/float, 6 dead reckoning) - default [1, 2, 4, 5]
+	 * Optionally, fixes with fewer than min_satellites satellites used or a PDOP above max_pdop are also rejected (0 for no limit, the default)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	size_t quality_count, i;
+	mp_obj_t *qualities;
+	mp_int_t quality, min_satellites = (n_args > 2) ? mp_obj_get_int(args[2]) : 0;
+	mp_float_t max_pdop = (n_args > 3) ? mp_obj_get_float(args[3]) : 0;
+	uint16_t mask = 0;
+
+	mp_obj_get_array(args[1], &quality_count, &qualities);
+
+	for (i = 0; i < quality_count; i++){
+		quality = mp_obj_get_int(qualities[i]);
+
+		if ((quality < 1) || (quality > FIX_QUALITY_MAX)){
+			mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Fix quality must be 1-8"));
+		}
+
+		mask |= 1 << quality;
+	}
+
+	if ((min_satellites < 0) || (min_satellites > 255) || (max_pdop < 0)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Limits can't be negative"));
+	}
+
+	self->fix_policy.qualities = mask;
+	self->fix_policy.min_satellites = min_satellites;
+	self->fix_policy.max_pdop = max_pdop;
+
+	return mp_const_none;
+}
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_fix_policy_obj, 2, 4, fix_policy);
+
+mp_obj_t fix_status(mp_obj_t self_in){
+	/**
+	 * Micropython-exposed function
+	 * Returns the quality of the last fix used as a tuple: (quality, fix type, satellites used, PDOP, HDOP, VDOP, count, PRN, talker)
+	 * Quality is the GGA indicator (0 if there hasn't been a fix), fix type is 2 for 2D and 3 for 3D
+	 * PRN/talker are uint8 arrays of the satellites used in the latest epoch's GSA sentences, with the same talkers as satellites()
+	 * Like satellites(), they're memoryviews straight onto the driver's table, so they change as new GSA sentences arrive
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-	int8_t flag, bytes_written;
+	gsa_table_t* table = &(self->gsa);
 
-	// Defining the UBX-CFG-RST packet to send
-	// Doesn't need to be in error catching, but needs write_method to be defined
-	uint8_t packet[12] = {0xB5, 0x62, 0x06, 0x04, 0x04, 0x00, 0x00, 0x00, 0x09, 0x00, 0x17, 0x76};
+	update_buffer_internal(self);
 
-	// Sending the UBX packet
-	bytes_written = uart_write_bytes(self->uart_number, packet, 12);
-	flag = ubx_ack_nack(self);
+	mp_obj_t status_tuple[9] = {mp_obj_new_int(self->data.fix_quality),
+	                            mp_obj_new_int(self->data.fix_type),
+	                            mp_obj_new_int(self->data.satellites_used),
+	                            mp_obj_new_float(self->data.pdop),
+	                            mp_obj_new_float(self->data.hdop),
+	                            mp_obj_new_float(self->data.vdop),
+	                            mp_obj_new_int(table->count),
+	                            mp_obj_new_memoryview('B', table->count, table->prn),
+	                            mp_obj_new_memoryview('B', table->count, table->talker)};
+
+	return mp_obj_new_tuple(9, status_tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_fix_status_obj, fix_status);
 
-	if (bytes_written != 12){
-		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+static uint16_t rate_to_meas_ms(mp_obj_t rate_in){
+	/**
+	 * Converts a measurement rate (Hz) to a UBX-CFG-RATE measRate (ms), checking it's within what the module can do
+	*/
+	mp_float_t rate = mp_obj_get_float(rate_in);
+
+	if ((rate <= 0) || (rate > 1000.0f / RATE_MIN_MEAS_MS) || (rate < 1000.0f / 65535)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Rate must be between 0.016 and 40 Hz"));
+	}
+
+	return 1000.0f / rate + 0.5f;
+}
+
+mp_obj_t setrate(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Sets the navigation rate with UBX-CFG-RATE: setrate(rate, nav_rate, time_ref)
+	 * rate is the measurement rate (Hz), nav_rate the number of measurements per navigation solution (default 1), and time_ref what the
+	 * measurements are aligned to (0 UTC (default), 1 GPS, 2 GLONASS, 3 BeiDou, 4 Galileo). Turns the adaptive rate off
+	 * The applied rate is read back from the module afterwards
+	 * Returns 1 if an ACK was received and the rate read back matches, 0 if a NACK was received or it doesn't match, and -1 if nothing received
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	uint16_t meas_rate_ms = rate_to_meas_ms(args[1]);
+	mp_int_t nav_rate = (n_args > 2) ? mp_obj_get_int(args[2]) : 1;
+	mp_int_t time_ref = (n_args > 3) ? mp_obj_get_int(args[3]) : 0;
+	int8_t flag;
+
+	if ((nav_rate < 1) || (nav_rate > RATE_MAX_NAV)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Measurements per navigation solution must be 1-127"));
+	}
+	if ((time_ref < 0) || (time_ref > RATE_MAX_TIME_REF)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Time reference must be 0-4"));
+	}
+
+	self->rate.adaptive = 0;
+
+	cfg_rate_write(self, meas_rate_ms, nav_rate, time_ref);
+	flag = ubx_ack_nack(self, 0x06, 0x08);
+
+	if (flag != 1){
+		return mp_obj_new_int(flag);
+	}
+
+	flag = cfg_rate_read(self);
+
+	if ((flag == 1) && ((self->rate.meas_rate_ms != meas_rate_ms) || (self->rate.nav_rate != nav_rate) || (self->rate.time_ref != time_ref))){
+		flag = 0;
 	}
 
 	return mp_obj_new_int(flag);
 }
-static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_gnss_start_obj, gnss_start);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_setrate_obj, 2, 4, setrate);
 
-mp_obj_t setrate(mp_obj_t self_in, mp_obj_t rate, mp_obj_t measurements_per_nav_sol){
+mp_obj_t getrate(mp_obj_t self_in){
 	/**
-	 * Function to change rate of new navigation solutions output for the NEO-M8
-	 * Returns 1 if an ACK was received, 0 if a NACK was received, and -1 if nothing received
+	 * Micropython-exposed function
+	 * Reads the navigation rate back from the module with a UBX-CFG-RATE poll
+	 * Returns (measurement period (ms), measurements per navigation solution, time reference, navigation rate (Hz)), or None if nothing received
 	*/
 	neo_m8_obj_t *self = MP_OBJ_TO_PTR(self_in);
-	int8_t flag;
-	uint8_t bytes_written, i, ck_a = 0, ck_b = 0;
+	nav_rate_t* rate = &(self->rate);
 
-	float mp_rate = mp_obj_get_float(rate);
-	if ((mp_rate < 0) || (mp_rate > 10)){
-		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Invalid GPS data output rate. Rate must be between 0 and 10 Hz."));
+	if (cfg_rate_read(self) != 1){
+		return mp_const_none;
 	}
 
-	uint8_t ms_rate = (uint8_t)(1000/mp_rate), measurements_nav_sol = mp_obj_get_uint(measurements_per_nav_sol);
+	mp_obj_t rate_tuple[4] = {mp_obj_new_int(rate->meas_rate_ms),
+	                          mp_obj_new_int(rate->nav_rate),
+	                          mp_obj_new_int(rate->time_ref),
+	                          mp_obj_new_float((rate->meas_rate_ms * rate->nav_rate == 0) ? 0.0f : 1000.0f / (rate->meas_rate_ms * rate->nav_rate))};
 
-	uint8_t bytes_packet[8] = {0x06, 0x08, 0x06, 0x00, ms_rate, measurements_nav_sol, 0x00, 0x00};
+	return mp_obj_new_tuple(4, rate_tuple);
+}
+static MP_DEFINE_CONST_FUN_OBJ_1(neo_m8_getrate_obj, getrate);
 
-	// Calculating the UBX checksum
-	for (i = 0; i < 8; i++){
-		ck_a += bytes_packet[i];
-		ck_b += ck_a;
+mp_obj_t rate_adaptive(size_t n_args, const mp_obj_t *args){
+	/**
+	 * Micropython-exposed function
+	 * Turns the adaptive navigation rate on: rate_adaptive(fast_rate, slow_rate, speed_threshold, hold_ms), or off: rate_adaptive(None)
+	 * The module runs at slow_rate (Hz) until a fix's speed goes above speed_threshold (m/s), then at fast_rate until the speed has been below half
+	 * the threshold for hold_ms (default 5000). The rate is checked with each fix read by position()/altitude()/getdata()
+	 * navRate/timeRef are kept from the last setrate()/getrate(). Starts at the slow rate
+	 * Returns 1 if an ACK was received for the slow rate, 0 if a NACK was received, and -1 if nothing received (None when turning it off)
+	*/
+	neo_m8_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+	nav_rate_t* rate = &(self->rate);
+	mp_float_t threshold;
+	mp_int_t hold_ms;
+
+	if (args[1] == mp_const_none){
+		rate->adaptive = 0;
+		return mp_const_none;
 	}
-	ck_a &= 0xFF;
-	ck_b &= 0xFF;
 
-	// Putting together the final data packet
-	uint8_t packet[12] = {0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, ms_rate, measurements_nav_sol, 0x00, 0x00, ck_a, ck_b};
+	if (n_args < 4){
+		mp_raise_msg(&mp_type_TypeError, MP_ERROR_TEXT("Fast rate, slow rate and speed threshold are needed"));
+	}
 
-	// Writing the packet to the UART
-	bytes_written = uart_write_bytes(self->uart_number, packet, 12);
-	flag = ubx_ack_nack(self);
+	threshold = mp_obj_get_float(args[3]);
+	hold_ms = (n_args > 4) ? mp_obj_get_int(args[4]) : RATE_ADAPTIVE_DEFAULT_HOLD_MS;
 
-	if (bytes_written != 12){
-		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
+	if ((threshold <= 0) || (hold_ms < 0)){
+		mp_raise_msg(&mp_type_ValueError, MP_ERROR_TEXT("Speed threshold must be positive and hold time can't be negative"));
 	}
 
-	return mp_obj_new_int(flag);
+	rate->fast_meas_rate_ms = rate_to_meas_ms(args[1]);
+	rate->slow_meas_rate_ms = rate_to_meas_ms(args[2]);
+	rate->threshold_mms = threshold * 1000;
+	rate->hold_ms = hold_ms;
+
+	if (rate->nav_rate == 0){
+		rate->nav_rate = 1;
+	}
+
+	rate->adaptive = 1;
+	rate->fast = 0;
+	rate->moving_us = 0;
+	memset(&(rate->switch_ack), 0, sizeof(ubx_pending_t));
+	rate->switch_ack.result = -1;
+
+	cfg_rate_write(self, rate->slow_meas_rate_ms, rate->nav_rate, rate->time_ref);
+
+	return mp_obj_new_int(ubx_ack_nack(self, 0x06, 0x08));
 }
-static MP_DEFINE_CONST_FUN_OBJ_3(neo_m8_setrate_obj, setrate);
+static MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neo_m8_rate_adaptive_obj, 2, 5, rate_adaptive);
 
 mp_obj_t modulesetup(mp_obj_t self_in){
 	/**
@@ -787,7 +5151,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 	}
 
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet[2], packet[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -806,7 +5170,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 	}
 
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet2[2], packet2[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -824,7 +5188,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
 	}
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet3[2], packet3[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -842,7 +5206,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 	}
 
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet4[2], packet4[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -859,7 +5223,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 		mp_raise_msg(&mp_type_RuntimeError, MP_ERROR_TEXT("UART write failed"));
 	}
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet5[2], packet5[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -879,7 +5243,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 	}
 
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet6[2], packet6[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -897,7 +5261,7 @@ mp_obj_t modulesetup(mp_obj_t self_in){
 	}
 
 	// Checking for ACK/NACK, returning if no ACK found
-	flag = ubx_ack_nack(self);
+	flag = ubx_ack_nack(self, packet7[2], packet7[3]);
 
 	if (flag != 1){
 		return mp_obj_new_int(flag);
@@ -919,11 +5283,52 @@ static const mp_rom_map_elem_t neo_m8_locals_dict_table[] = {
 	{MP_ROM_QSTR(MP_QSTR_velocity), MP_ROM_PTR(&neo_m8_velocity_obj)},
 	{MP_ROM_QSTR(MP_QSTR_altitude), MP_ROM_PTR(&neo_m8_altitude_obj)},
 	{MP_ROM_QSTR(MP_QSTR_timestamp), MP_ROM_PTR(&neo_m8_timestamp_obj)},
+	{MP_ROM_QSTR(MP_QSTR_gps_time), MP_ROM_PTR(&neo_m8_gps_time_obj)},
+	{MP_ROM_QSTR(MP_QSTR_gps_time_now), MP_ROM_PTR(&neo_m8_gps_time_now_obj)},
+	{MP_ROM_QSTR(MP_QSTR_satellites), MP_ROM_PTR(&neo_m8_satellites_obj)},
 	{MP_ROM_QSTR(MP_QSTR_getdata), MP_ROM_PTR(&neo_m8_getdata_obj)},
+	{MP_ROM_QSTR(MP_QSTR_position_at), MP_ROM_PTR(&neo_m8_position_at_obj)},
+	{MP_ROM_QSTR(MP_QSTR_history_at), MP_ROM_PTR(&neo_m8_history_at_obj)},
+	{MP_ROM_QSTR(MP_QSTR_history_into), MP_ROM_PTR(&neo_m8_history_into_obj)},
+	{MP_ROM_QSTR(MP_QSTR_history_view), MP_ROM_PTR(&neo_m8_history_view_obj)},
+	{MP_ROM_QSTR(MP_QSTR_log_start), MP_ROM_PTR(&neo_m8_log_start_obj)},
+	{MP_ROM_QSTR(MP_QSTR_log_stop), MP_ROM_PTR(&neo_m8_log_stop_obj)},
+	{MP_ROM_QSTR(MP_QSTR_record), MP_ROM_PTR(&neo_m8_record_obj)},
+	{MP_ROM_QSTR(MP_QSTR_geofence_add), MP_ROM_PTR(&neo_m8_geofence_add_obj)},
+	{MP_ROM_QSTR(MP_QSTR_geofence_check), MP_ROM_PTR(&neo_m8_geofence_check_obj)},
+	{MP_ROM_QSTR(MP_QSTR_geofence_clear), MP_ROM_PTR(&neo_m8_geofence_clear_obj)},
+	{MP_ROM_QSTR(MP_QSTR_distances_to), MP_ROM_PTR(&neo_m8_distances_to_obj)},
+	{MP_ROM_QSTR(MP_QSTR_bearings_to), MP_ROM_PTR(&neo_m8_bearings_to_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_origin), MP_ROM_PTR(&neo_m8_set_origin_obj)},
+	{MP_ROM_QSTR(MP_QSTR_enu_into), MP_ROM_PTR(&neo_m8_enu_into_obj)},
+	{MP_ROM_QSTR(MP_QSTR_kalman), MP_ROM_PTR(&neo_m8_kalman_obj)},
+	{MP_ROM_QSTR(MP_QSTR_filtered_state), MP_ROM_PTR(&neo_m8_filtered_state_obj)},
 	{MP_ROM_QSTR(MP_QSTR_update_buffer), MP_ROM_PTR(&neo_m8_update_buffer_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_sentence_filter), MP_ROM_PTR(&neo_m8_set_sentence_filter_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_message_rate), MP_ROM_PTR(&neo_m8_set_message_rate_obj)},
 	{MP_ROM_QSTR(MP_QSTR_gnss_start), MP_ROM_PTR(&neo_m8_gnss_start_obj)},
 	{MP_ROM_QSTR(MP_QSTR_gnss_stop), MP_ROM_PTR(&neo_m8_gnss_stop_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_power_mode), MP_ROM_PTR(&neo_m8_set_power_mode_obj)},
+	{MP_ROM_QSTR(MP_QSTR_power_sleep), MP_ROM_PTR(&neo_m8_power_sleep_obj)},
+	{MP_ROM_QSTR(MP_QSTR_save_navdb), MP_ROM_PTR(&neo_m8_save_navdb_obj)},
+	{MP_ROM_QSTR(MP_QSTR_restore_navdb), MP_ROM_PTR(&neo_m8_restore_navdb_obj)},
+	{MP_ROM_QSTR(MP_QSTR_load_assistnow), MP_ROM_PTR(&neo_m8_load_assistnow_obj)},
+	{MP_ROM_QSTR(MP_QSTR_aid), MP_ROM_PTR(&neo_m8_aid_obj)},
+	{MP_ROM_QSTR(MP_QSTR_ttff_log), MP_ROM_PTR(&neo_m8_ttff_log_obj)},
+	{MP_ROM_QSTR(MP_QSTR_startup_profile), MP_ROM_PTR(&neo_m8_startup_profile_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_watchdog), MP_ROM_PTR(&neo_m8_set_watchdog_obj)},
+	{MP_ROM_QSTR(MP_QSTR_set_baudrate), MP_ROM_PTR(&neo_m8_set_baudrate_obj)},
+	{MP_ROM_QSTR(MP_QSTR_health), MP_ROM_PTR(&neo_m8_health_obj)},
+	{MP_ROM_QSTR(MP_QSTR_rf_monitor), MP_ROM_PTR(&neo_m8_rf_monitor_obj)},
+	{MP_ROM_QSTR(MP_QSTR_rf_status), MP_ROM_PTR(&neo_m8_rf_status_obj)},
+	{MP_ROM_QSTR(MP_QSTR_accuracy), MP_ROM_PTR(&neo_m8_accuracy_obj)},
+	{MP_ROM_QSTR(MP_QSTR_velocity_ned_into), MP_ROM_PTR(&neo_m8_velocity_ned_into_obj)},
+	{MP_ROM_QSTR(MP_QSTR_pubx_mode), MP_ROM_PTR(&neo_m8_pubx_mode_obj)},
+	{MP_ROM_QSTR(MP_QSTR_fix_policy), MP_ROM_PTR(&neo_m8_fix_policy_obj)},
+	{MP_ROM_QSTR(MP_QSTR_fix_status), MP_ROM_PTR(&neo_m8_fix_status_obj)},
 	{MP_ROM_QSTR(MP_QSTR_setrate), MP_ROM_PTR(&neo_m8_setrate_obj)},
+	{MP_ROM_QSTR(MP_QSTR_getrate), MP_ROM_PTR(&neo_m8_getrate_obj)},
+	{MP_ROM_QSTR(MP_QSTR_rate_adaptive), MP_ROM_PTR(&neo_m8_rate_adaptive_obj)},
 	{MP_ROM_QSTR(MP_QSTR_modulesetup), MP_ROM_PTR(&neo_m8_modulesetup_obj)},
 };
 static MP_DEFINE_CONST_DICT(neo_m8_locals_dict, neo_m8_locals_dict_table);
@@ -951,3 +5356,4 @@ const mp_obj_module_t neo_m8_module = {
 };
 
 MP_REGISTER_MODULE(MP_QSTR_neo_m8, neo_m8_module);
+MP_REGISTER_ROOT_POINTER(void *neo_m8_pps_driver);
@@ -4,21 +4,174 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <sys/time.h>
 
 #include "py/runtime.h"
 #include "py/obj.h"
 #include "py/objstr.h"
 #include "py/mphal.h"
+#include "py/stream.h"
+#include "py/builtin.h"
+#include "py/mperrno.h"
 
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "freertos/timers.h"
 #include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_attr.h"
+
+#include "neo_m8_core.h"
 
 // Constant definitions
 #define CHAR_PTR_SIZE sizeof(char*)
 #define FLOAT_SIZE sizeof(float)
 #define INTERNAL_BUFFER_LENGTH 512
+#define GSV_MAX_SATELLITES 72
+#define GSV_TALKER_COUNT 6
+#define GSA_MAX_SATELLITES 64
+#define NMEA_MAX_LENGTH 82
+#define PUBX_MAX_LENGTH 128
+#define FRAME_MAX_LENGTH 256
+#define UBX_MAX_PAYLOAD_LENGTH 256
+#define UBX_ACK_TIMEOUT_US 1000000
+#define UART_CHUNK_LENGTH 128
+#define UART_RX_BUFFER_LENGTH 512
+#define UART_RX_BUFFER_MS 200
+#define NMEA_FILTER_ALL 0xFFFFFFFF
+
+// GPS time started at 1980-01-06T00:00:00Z, and is ahead of UTC by the leap seconds since then
+// The receiver's own count (from UBX-NAV-TIMEGPS, polled until it's known) is used where there is one - 18 (as of 2017) is only a fallback
+#define GPS_EPOCH_UNIX_MS 315964800000LL
+#define GPS_LEAP_SECONDS 18
+#define LEAP_SECONDS_POLL_US 10000000
+
+// Unit conversions - MM_PER_DEGREE is in neo_m8_core.h
+#define DEG_TO_RAD 0.0174532925f
+#define KNOTS_TO_MMS 514.444f
+#define DEG_TO_RAD_DOUBLE 0.017453292519943295
+#define EARTH_RADIUS_M 6371008.8
+#define WGS84_A 6378137.0
+#define WGS84_F (1/298.257223563)
+#define VINCENTY_MAX_ITERATIONS 100
+#define WGS84_E2 (WGS84_F * (2 - WGS84_F))
+#define E7_TO_RAD_DOUBLE (DEG_TO_RAD_DOUBLE / 1e7)
+
+// Fixes within this distance (m, east or north) of the local tangent plane's origin are projected with the series - further out, exactly
+#define ENU_SERIES_RANGE_M 5000.0
+
+// Extrapolation model - how far ahead a fix can be extrapolated, and how fast its uncertainty grows
+#define EXTRAPOLATION_MAX_US 10000000LL
+#define EXTRAPOLATION_SPEED_SIGMA_MMS 500
+#define EXTRAPOLATION_ACCELERATION_MMS2 2000
+
+// Kalman filter defaults - process noise (white acceleration, m/s^2) and velocity measurement noise (m/s)
+#define KALMAN_DEFAULT_ACCELERATION_NOISE 2.0f
+#define KALMAN_VELOCITY_SIGMA 0.5f
+// Position errors are floored so no fix is treated as exact, and an empty one (no HDOP/hAcc) is taken as this many metres
+#define KALMAN_MIN_POSITION_SIGMA 0.1f
+#define KALMAN_UNKNOWN_POSITION_SIGMA 10.0f
+
+#define FIX_HISTORY_LENGTH 64
+
+#define RECORD_BLOCK_LENGTH 4096
+
+#define NAVDB_START_TIMEOUT_US 3000000
+#define NAVDB_IDLE_TIMEOUT_US 1000000
+#define MGA_ACK_TIMEOUT_US 250000
+#define MGA_UNACKED_PACING_US 20000
+
+#define RTC_AIDING_MAGIC 0x4E4D3841
+#define RTC_TTFF_LOG_LENGTH 16
+#define AIDING_TIME_BASE_US 1000000
+#define AIDING_CLOCK_DRIFT_PPM 5000
+#define AIDING_SPEED_MMS 1000
+#define AIDING_MAX_POSITION_ERROR_MM 100000000
+
+#define RTC_PROFILE_MAGIC 0x4E4D3850
+#define PROFILE_HISTOGRAM_BINS 13
+#define PROFILE_DEFAULT_ACCURACY_MM 5000
+#define HDOP_TO_ERROR_MM 2500
+
+#define POWER_MODE_CONTINUOUS 0
+#define POWER_MODE_CYCLIC 1
+#define POWER_MODE_ON_OFF 2
+#define POWER_DEFAULT_GUARD_MS 50
+#define POWER_UART_WAKEUP_EDGES 3
+
+#define WATCHDOG_DEFAULT_TIMEOUT_MS 5000
+#define WATCHDOG_GARBAGE_WINDOW 1024
+#define WATCHDOG_PROBE_US 1200000
+#define WATCHDOG_MAX_BACKOFF 4
+#define WATCHDOG_EVENT_LENGTH 8
+#define WATCHDOG_CONFIG_SLOTS 24
+#define WATCHDOG_CONFIG_MAX_LENGTH 52
+#define WATCHDOG_SILENT 1
+#define WATCHDOG_GARBAGE 2
+// Recovery attempt states - it's taken a step further with each read, rather than blocking one
+#define WATCHDOG_IDLE 0
+#define WATCHDOG_PROBING 1
+#define WATCHDOG_REPLAYING 2
+// How long the recovery's configuration replay waits for each message's ACK before moving on to the next
+#define WATCHDOG_REPLAY_ACK_US 200000
+
+#define MON_HW_FRAME_LENGTH 68
+#define NAV_TIMEGPS_FRAME_LENGTH 24
+#define NAV_PVT_FRAME_LENGTH 100
+#define NAV_POSLLH_FRAME_LENGTH 36
+#define NAV_VELNED_FRAME_LENGTH 44
+
+// Receiver accuracy estimates/velocities are only used for a fix whose UTC time of day is within this of theirs (NMEA times are to 10ms)
+#define ACCURACY_EPOCH_TOLERANCE_MS 10
+#define ACCURACY_SOURCE_NONE 0
+#define ACCURACY_SOURCE_NAV_PVT 1
+#define ACCURACY_SOURCE_NAV_POSLLH 2
+#define ACCURACY_SOURCE_PUBX 3
+
+#define VELOCITY_SOURCE_NONE 0
+#define VELOCITY_SOURCE_NAV_PVT 1
+#define VELOCITY_SOURCE_NAV_VELNED 2
+#define VELOCITY_SOURCE_PUBX 3
+#define VELOCITY_NED_ITEMS 6
+
+#define PUBX_DEFAULT_POLL_PERIOD_MS 1000
+#define PUBX_FIELD_COUNT 21
+#define KMH_TO_KNOTS 0.539957f
+
+// Fixes accepted by default - GGA quality 1 (GPS), 2 (DGPS/SBAS), 4 (RTK fixed) and 5 (RTK float), but not 6 (dead reckoning)
+#define FIX_POLICY_DEFAULT_QUALITIES ((1 << 1) | (1 << 2) | (1 << 4) | (1 << 5))
+#define FIX_QUALITY_MAX 8
+
+// UBX-CFG-RATE limits - measRate (ms) is the time between measurements, navRate the measurements per navigation solution,
+// timeRef what the measurements are aligned to (0 UTC, 1 GPS, 2 GLONASS, 3 BeiDou, 4 Galileo)
+#define CFG_RATE_FRAME_LENGTH 14
+#define RATE_MIN_MEAS_MS 25
+#define RATE_MAX_NAV 127
+#define RATE_MAX_TIME_REF 4
+
+// The adaptive rate only drops back to the slow rate after the speed has been below half the threshold for this long (default)
+#define RATE_ADAPTIVE_DEFAULT_HOLD_MS 5000
+// An adaptive rate switch that isn't ACKed is only sent again after the hold time - or after this long, if that's shorter
+#define RATE_ADAPT_MIN_RETRY_MS 1000
+#define JAMMING_WARNING 2
+#define RF_STATUS_ITEMS 7
+
+// States of the framing layer, which splits the UART byte stream into NMEA sentences and UBX frames
+typedef enum {
+    FRAME_IDLE,
+    FRAME_NMEA,
+    FRAME_NMEA_DROP,
+    FRAME_UBX
+} frame_state_t;
+
+// Struct to map a message name onto its UBX class/ID (as used by UBX-CFG-MSG)
+typedef struct {
+    const char* name;
+    uint8_t msg_class;
+    uint8_t msg_id;
+} message_id_t;
 
 // Struct to return NMEA sentence data
 typedef struct {
@@ -26,6 +179,14 @@ typedef struct {
     uint8_t length;
 } nmea_sentence_data_t;
 
+// Struct to track UTC time from NMEA sentences - milliseconds since midnight, days since 1970-01-01 (from RMC),
+// and the two combined as microseconds since 1970-01-01
+typedef struct {
+    uint32_t time_of_day_ms;
+    int32_t date_days;
+    int64_t utc_us;
+} utc_time_t;
+
 // Struct to hold parsed data
 typedef struct {
     float latitude;
@@ -35,37 +196,475 @@ typedef struct {
     float altitude;
     float geosep;
     float vertical_error;
+    // Set once a GGA has given the geoid separation - until then, altitude from PUBX,00 is height above the ellipsoid
+    uint8_t geosep_valid;
 
     float sog;
     float cog;
 
-    char timestamp[9];
-    char date[7];
+    utc_time_t time;
+
+    // Quality of the fix - GGA quality indicator (0 invalid, 1 GPS, 2 DGPS/SBAS, 4/5 RTK fixed/float, 6 dead reckoning),
+    // fix type (1 none, 2 2D, 3 3D), satellites used, and dilutions of precision
+    uint8_t fix_quality;
+    uint8_t fix_type;
+    uint8_t satellites_used;
+    float pdop;
+    float hdop;
+    float vdop;
+
+    // North/east/down velocity (cm/s) and speed accuracy (cm/s, -1 if unknown) - updated as soon as UBX-NAV-VELNED/NAV-PVT arrives,
+    // or from PUBX,00 with each fix in PUBX mode
+    int32_t velocity_north_cms;
+    int32_t velocity_east_cms;
+    int32_t velocity_down_cms;
+    int32_t speed_accuracy_cms;
+    uint8_t velocity_source;
+    int64_t velocity_received_us;
+    int32_t velocity_time_of_day_ms;
+
+    // Fixed-point copy of the latest fix, used for extrapolation: 1e-7 degrees, mm, mm/s
+    int32_t latitude_e7;
+    int32_t longitude_e7;
+    int32_t altitude_mm;
+    int32_t position_error_mm;
+    int32_t velocity_north_mms;
+    int32_t velocity_east_mms;
+    int32_t velocity_down_mms;
+    int32_t lon_mm_per_degree;
+    int64_t fix_utc_us;
 } gps_data_t;
 
+// Struct to hold the satellites in view, assembled from GSV sentences
+// Stored as parallel arrays so they can be handed to micropython as memoryviews without copying
+// The same struct stages multi-part groups until their last message arrives
+typedef struct {
+    uint8_t prn[GSV_MAX_SATELLITES];
+    uint8_t elevation[GSV_MAX_SATELLITES];
+    int16_t azimuth[GSV_MAX_SATELLITES];
+    uint8_t cno[GSV_MAX_SATELLITES];
+    uint8_t talker[GSV_MAX_SATELLITES];
+    uint8_t count;
+
+    // Next expected GSV message number for each talker, 0 if no group is in progress
+    uint8_t next_message[GSV_TALKER_COUNT];
+} gsv_table_t;
+
+// Struct to hold the satellites used in the latest fix, its fix type and DOPs, assembled from that epoch's GSA sentences (one per constellation)
+// The PRN/talker arrays are handed to micropython as memoryviews, like the GSV table
+typedef struct {
+    uint8_t prn[GSA_MAX_SATELLITES];
+    uint8_t talker[GSA_MAX_SATELLITES];
+    uint8_t count;
+    uint8_t fix_type;
+    float pdop;
+    float hdop;
+    float vdop;
+
+    // Whether the last sentence was a GSA - if not, the next GSA starts a new epoch
+    uint8_t in_progress;
+} gsa_table_t;
+
+// Struct to hold which fixes are used - a bitmask of accepted GGA quality indicators, and optional limits (0 for none)
+typedef struct {
+    uint16_t qualities;
+    uint8_t min_satellites;
+    float max_pdop;
+} fix_policy_t;
+
+// Struct to hold the local tangent plane - the origin, the factors cached to project fixes near it (radii of curvature in m, including the
+// origin's height), its ECEF position and ECEF to east/north/up rotation for fixes further out, and the latest fix in it
+typedef struct {
+    double origin_latitude_e7;
+    double origin_longitude_e7;
+    int32_t origin_height_mm;
+    double sin_latitude;
+    double cos_latitude;
+    double meridian_radius;
+    double prime_vertical_radius;
+    double north_curvature;
+    double origin_ecef[3];
+    double rotation[3][3];
+    int32_t east_mm;
+    int32_t north_mm;
+    int32_t up_mm;
+    uint8_t enabled;
+} enu_frame_t;
+
+// Struct to hold the receiver's own accuracy estimates (1 sigma) - position from UBX-NAV-PVT/NAV-POSLLH or PUBX,00, speed/heading from UBX-NAV-PVT
+// Each has the UTC time of day (ms, -1 if none yet) of the epoch it's for, to match it to the fix from the same epoch
+typedef struct {
+    uint32_t horizontal_mm;
+    uint32_t vertical_mm;
+    uint8_t source;
+    int64_t received_us;
+    int32_t time_of_day_ms;
+
+    uint32_t speed_mms;
+    uint32_t heading_e5;
+    int64_t velocity_received_us;
+    int32_t velocity_time_of_day_ms;
+} accuracy_t;
+
+// Struct to hold PUBX,00 mode - the latest sentence, kept by the framing layer until the fix pipeline picks it up, and its polling
+typedef struct {
+    char sentence[PUBX_MAX_LENGTH + 1];
+    uint8_t length;
+    uint8_t pending;
+    uint8_t enabled;
+    uint32_t poll_period_ms;
+    int64_t polled_us;
+} pubx_t;
+
+// Struct for a UBX packet sent without waiting for its ACK - the framing layer fills in the result when its UBX-ACK-ACK/NAK arrives
+typedef struct {
+    int64_t sent_us;
+    uint8_t msg_class;
+    uint8_t msg_id;
+    uint8_t waiting;
+    int8_t result;
+} ubx_pending_t;
+
+// Struct to hold the navigation rate - the last UBX-CFG-RATE read back from the module, and the adaptive rate settings
+typedef struct {
+    uint16_t meas_rate_ms;
+    uint16_t nav_rate;
+    uint16_t time_ref;
+    uint8_t sequence;
+
+    // Solution periods used above/below the speed threshold, and when the speed was last above half of it
+    uint8_t adaptive;
+    uint8_t fast;
+    uint16_t fast_meas_rate_ms;
+    uint16_t slow_meas_rate_ms;
+    uint32_t threshold_mms;
+    uint32_t hold_ms;
+    int64_t moving_us;
+
+    // The last switch sent (to the fast rate or not) - sent_us is cleared once it's ACKed, until then it's only sent again after the hold time
+    ubx_pending_t switch_ack;
+    uint8_t switch_fast;
+} nav_rate_t;
+
+// Struct to hold the last FIX_HISTORY_LENGTH fixes, oldest overwritten first
+typedef struct {
+    fix_record_t records[FIX_HISTORY_LENGTH];
+    uint16_t head;
+    uint16_t count;
+} fix_history_t;
+
+// Struct to hold the binary track log - fixes are delta/varint encoded into a flash-sector sized block, which is written out once full
+typedef struct {
+    mp_obj_t file;
+    uint8_t* block;
+    uint16_t block_length;
+    track_encoder_t encoder;
+    uint32_t fix_count;
+    uint32_t bytes_written;
+} track_log_t;
+
+// Struct to hold the raw stream recorder - UART bytes are copied into one block while the other, once full, waits for the reading call to write it out
+typedef struct {
+    mp_obj_t file;
+    uint8_t* blocks;
+    uint16_t block_length;
+    uint8_t active;
+    uint8_t pending;
+    uint32_t bytes_recorded;
+} stream_recorder_t;
+
+// Struct kept in RTC memory across deep sleep and resets (but not power cycles) - the last good fix, for aiding
+// the next startup, and the time to first fix of recent boots
+typedef struct {
+    uint32_t magic;
+    int32_t latitude_e7;
+    int32_t longitude_e7;
+    int32_t altitude_mm;
+    int32_t position_error_mm;
+    int64_t fix_utc_us;
+    int64_t system_us;
+
+    uint32_t ttff_ms[RTC_TTFF_LOG_LENGTH];
+    uint8_t ttff_aided[RTC_TTFF_LOG_LENGTH];
+    uint8_t ttff_head;
+    uint8_t ttff_count;
+} rtc_aiding_t;
+
+// Startup milestones, in the order they're expected to happen
+typedef enum {
+    MILESTONE_UART_UP,
+    MILESTONE_FIRST_BYTE,
+    MILESTONE_FIRST_NMEA,
+    MILESTONE_FIX_2D,
+    MILESTONE_FIX_3D,
+    MILESTONE_FIX_ACCURATE,
+    MILESTONE_COUNT
+} milestone_t;
+
+// Struct to hold when each startup milestone was reached (us after the start, -1 if not yet), and whether the start goes in the histogram
+typedef struct {
+    int64_t start_us;
+    int64_t milestone_us[MILESTONE_COUNT];
+    int32_t accuracy_threshold_mm;
+    uint8_t in_histogram;
+} startup_profile_t;
+
+// Struct kept in RTC memory across deep sleep and resets - histogram of time to first 3D fix over repeated starts
+typedef struct {
+    uint32_t magic;
+    uint16_t counts[PROFILE_HISTOGRAM_BINS];
+} rtc_profile_t;
+
+// Struct for one recovery attempt by the watchdog - what triggered it, the baud rate the module was found at (0 if it wasn't),
+// and how many of the cached configuration messages were ACKed when re-sent
+typedef struct {
+    int64_t time_us;
+    uint32_t baud_rate;
+    uint8_t reason;
+    uint8_t replayed;
+} watchdog_event_t;
+
+// Struct for a UBX-CFG message sent to the module (the whole packet), kept so it can be re-sent if the module loses its configuration
+typedef struct {
+    uint8_t packet[WATCHDOG_CONFIG_MAX_LENGTH];
+    uint8_t length;
+} config_packet_t;
+
+// Struct to hold the hardware health watchdog - activity/garbage counters from the reader path, recent recovery attempts,
+// and the configuration cache
+typedef struct {
+    uint32_t timeout_ms;
+    uint8_t paused;
+    uint8_t state;
+    uint8_t failures;
+    int64_t last_byte_us;
+    int64_t last_frame_us;
+    uint32_t frame_count;
+    uint32_t byte_count;
+    uint32_t garbage_count;
+
+    // Bytes read and bytes that weren't part of a valid sentence/frame since the garbage check last ran,
+    // and how much of an oversized UBX frame is still to come (not garbage, just too big for the framing buffer)
+    uint32_t window_bytes;
+    uint32_t window_garbage;
+    uint16_t skip_bytes;
+
+    watchdog_event_t events[WATCHDOG_EVENT_LENGTH];
+    uint8_t event_head;
+    uint8_t event_count;
+    uint16_t recoveries;
+
+    config_packet_t config[WATCHDOG_CONFIG_SLOTS];
+    uint8_t config_count;
+
+    // The recovery attempt in hand - the baud rate it started from, the one being probed (0 is the original), the frame count when
+    // that probe started, and the next cached configuration message to re-send
+    uint32_t original_baud_rate;
+    uint32_t probe_frame_count;
+    int64_t step_us;
+    uint8_t probe_index;
+    uint8_t replay_index;
+    ubx_pending_t replay_ack;
+} watchdog_t;
+
+// Struct to hold the latest UBX-MON-HW RF/antenna status, and the polling that keeps it up to date
+typedef struct {
+    uint16_t noise_per_ms;
+    uint16_t agc_count;
+    uint8_t jam_indicator;
+    uint8_t jamming_state;
+    uint8_t antenna_status;
+    uint8_t antenna_power;
+    int64_t received_us;
+
+    // Polled every poll_period_ms (0 if not polling), and the callback is scheduled when jammingState rises to warning or critical
+    uint32_t poll_period_ms;
+    int64_t polled_us;
+    mp_obj_t callback;
+} rf_monitor_t;
+
 // Object definition
 typedef struct {
 	mp_obj_base_t base;
 	uart_port_t uart_number;
+	uint16_t uart_buffer_length;
 
 	uint8_t buffer[INTERNAL_BUFFER_LENGTH];
 	uint16_t buffer_length;
 
+    // Framing layer - the sentence/frame currently being received, before it is let into the buffer
+    uint8_t frame[FRAME_MAX_LENGTH];
+    uint16_t frame_length;
+    uint16_t frame_expected_length;
+    frame_state_t frame_state;
+    uint32_t sentence_filter;
+
+    // Most recent UBX-ACK-ACK/NAK received for the packet (class/ID) being waited on
+    uint8_t ubx_ack_sequence;
+    int8_t ubx_ack_result;
+    uint8_t ubx_ack_class;
+    uint8_t ubx_ack_id;
+
+    // Most recent UBX-MGA-ACK-DATA0 received - flow control for aiding data sent to the module
+    uint8_t mga_ack_sequence;
+    uint8_t mga_ack_type;
+    uint8_t mga_ack_msg_id;
+    uint8_t mga_ack_payload_start[4];
+
+    // File UBX-MGA-DBD frames are written to while save_navdb() runs
+    mp_obj_t navdb_file;
+    uint16_t navdb_count;
+    int navdb_error;
+    int64_t navdb_last_us;
+
+    // When the current UART chunk was read, and when the last GGA/RMC arrived (local esp_timer time) along with its UTC time
+    int64_t chunk_received_us;
+    int64_t time_received_us;
+    utc_time_t received_time;
+
+    // Leap seconds between GPS time and UTC as reported by the receiver, and when UBX-NAV-TIMEGPS was last polled for them
+    int8_t leap_seconds;
+    uint8_t leap_seconds_valid;
+    int64_t leap_seconds_polled_us;
+
+    // PPS timepulse - the latch is written by the GPIO ISR, and paired with the UTC second it marks once that epoch's sentences arrive
+    gpio_num_t pps_pin;
+    pps_t pps;
+
+    // Receiver power save mode - its output arrives once per update period, so the ESP32 can sleep in between
+    uint8_t power_mode;
+    uint32_t update_period_ms;
+
+    // Whether this boot's first fix has been logged yet (from the start, if another driver was created first this boot), and whether time
+    // (bit 0) or position (bit 1) aiding was sent
+    uint8_t first_fix_logged;
+    uint8_t aided;
+
+    startup_profile_t profile;
+    watchdog_t watchdog;
+    rf_monitor_t rf;
+    accuracy_t accuracy;
+    pubx_t pubx;
+    nav_rate_t rate;
+
     gps_data_t data;
+    gsv_table_t satellites;
+    gsv_table_t satellites_staging;
+    gsa_table_t gsa;
+    fix_policy_t fix_policy;
+    kalman_t kalman;
+    fix_history_t history;
+    track_log_t track;
+    stream_recorder_t recorder;
+    geofence_set_t geofences;
+    enu_frame_t enu;
 } neo_m8_obj_t;
 
 // Function declarations
 static int16_t find_in_char_array(char *array, uint16_t length, char character_to_look_for, int16_t starting_point);
 static int8_t nmea_checksum(char *nmea_sentence, uint8_t length);
-static int8_t ubx_ack_nack(neo_m8_obj_t *self);
+static int8_t ubx_ack_nack(neo_m8_obj_t *self, uint8_t msg_class, uint8_t msg_id);
+static void ubx_pending_start(ubx_pending_t* pending, uint8_t msg_class, uint8_t msg_id);
+static uint8_t ubx_pending_ack(ubx_pending_t* pending, const uint8_t* frame, int64_t received_us);
+static int8_t ubx_file_read_frame(mp_obj_t file, uint8_t* frame, uint16_t* length);
+static int8_t mga_send_acked(neo_m8_obj_t* self, const uint8_t* frame, uint16_t length, uint8_t acked);
+static uint8_t mga_enable_ack(neo_m8_obj_t* self);
+static int32_t utc_today(neo_m8_obj_t* self);
+static void profile_start(neo_m8_obj_t* self, int64_t start_us, uint8_t in_histogram);
+static void profile_milestone(neo_m8_obj_t* self, milestone_t milestone, int64_t time_us);
+static void profile_accuracy(neo_m8_obj_t* self, int32_t accuracy_mm, int64_t time_us);
+static void profile_fix(neo_m8_obj_t* self);
+static int64_t system_time_us(void);
+static void rtc_save_fix(neo_m8_obj_t* self);
+static uint8_t rtc_aid(neo_m8_obj_t* self);
 static void update_buffer_internal(neo_m8_obj_t* self);
-static void extract_timestamp(char* nmea_section, char* timestamp_out);
-static void extract_lat_long(char* nmea_section, float* output);
+static void append_to_buffer(neo_m8_obj_t* self, const uint8_t* data, uint16_t length);
+static void frame_bytes(neo_m8_obj_t* self, const uint8_t* data, uint16_t length);
+static void handle_nmea_frame(neo_m8_obj_t* self);
+static void handle_ubx_frame(neo_m8_obj_t* self);
+static uint8_t ubx_class_valid(uint8_t msg_class);
+static int8_t nmea_message_index(const uint8_t* sentence);
+static int8_t message_lookup(const char* name, size_t length);
+static const message_id_t* find_message(const char* name, size_t length);
+static void ubx_checksum(const uint8_t* data, uint16_t length, uint8_t* ck_a, uint8_t* ck_b);
+static void ubx_write_packet(neo_m8_obj_t* self, uint8_t msg_class, uint8_t msg_id, const uint8_t* payload, uint16_t length);
+static void config_cache(watchdog_t* watchdog, const uint8_t* packet, uint16_t length);
+static void watchdog_frame(neo_m8_obj_t* self);
+static void watchdog_garbage(neo_m8_obj_t* self, uint16_t length);
+static void watchdog_check(neo_m8_obj_t* self, uint16_t bytes_read);
+static void watchdog_probe_start(neo_m8_obj_t* self);
+static uint8_t watchdog_probe(neo_m8_obj_t* self);
+static void watchdog_recover(neo_m8_obj_t* self, uint8_t reason);
+static void watchdog_step(neo_m8_obj_t* self);
+static void watchdog_finish(neo_m8_obj_t* self);
+static void rf_poll(neo_m8_obj_t* self);
+static void leap_seconds_poll(neo_m8_obj_t* self);
+static void rf_decode(neo_m8_obj_t* self);
+static uint32_t read_u32(const uint8_t* data);
+static void decode_nav_pvt(neo_m8_obj_t* self);
+static void decode_nav_posllh(neo_m8_obj_t* self);
+static void decode_nav_velned(neo_m8_obj_t* self);
+static uint8_t velocity_ned_fix(neo_m8_obj_t* self, int32_t time_of_day_ms);
+static void decode_pubx_accuracy(neo_m8_obj_t* self);
+static uint8_t accuracy_fresh(int32_t estimate_time_of_day_ms, int32_t fix_time_of_day_ms);
+static int32_t itow_time_of_day(neo_m8_obj_t* self, uint32_t itow_ms);
+static int32_t extract_time_of_day(char* nmea_section);
+static int32_t extract_date(char* nmea_section);
+static int32_t days_from_civil(int32_t year, uint8_t month, uint8_t day);
+static void civil_from_days(int32_t days, int32_t* year, uint8_t* month, uint8_t* day);
+static void update_utc_time(utc_time_t* time, int32_t time_of_day_ms, int32_t date_days);
+static void utc_to_gps_time(int64_t utc_us, int8_t leap_seconds, uint16_t* week, uint32_t* time_of_week_ms);
+static void format_timestamp(int64_t utc_us, char* timestamp_out);
+static char* nmea_field(char* sentence, uint8_t length, uint8_t index);
+static void pps_isr_handler(void* arg);
+static void pair_pps(neo_m8_obj_t* self, int32_t time_of_day_ms);
+static int32_t extract_lat_long(char* nmea_section);
+static void update_fix_snapshot(neo_m8_obj_t* self);
+static void process_fix(neo_m8_obj_t* self);
+static void kalman_position_fix(neo_m8_obj_t* self);
+static void kalman_velocity_fix(neo_m8_obj_t* self);
+static uint8_t history_push(neo_m8_obj_t* self);
+static fix_record_t* history_record(fix_history_t* history, uint16_t index);
+static int8_t history_lookup(fix_history_t* history, int64_t utc_us, int32_t* output);
+static void track_log_fix(neo_m8_obj_t* self, const fix_record_t* record);
+static void track_write_block(neo_m8_obj_t* self);
+static void track_close(neo_m8_obj_t* self);
+static void record_bytes(stream_recorder_t* recorder, const uint8_t* data, uint16_t length);
+static void record_backlog(neo_m8_obj_t* self, size_t length);
+static void record_flush(neo_m8_obj_t* self);
+static void record_write(neo_m8_obj_t* self, const uint8_t* block, uint16_t length);
+static void record_close(neo_m8_obj_t* self);
+static void geofence_fix(neo_m8_obj_t* self);
+static void haversine_float(float latitude, float longitude, const float* latitudes, const float* longitudes, float* output, size_t count);
+static void haversine_double(double latitude, double longitude, const double* latitudes, const double* longitudes, double* output, size_t count);
+static void bearing_float(float latitude, float longitude, const float* latitudes, const float* longitudes, float* output, size_t count);
+static void bearing_double(double latitude, double longitude, const double* latitudes, const double* longitudes, double* output, size_t count);
+static double vincenty_distance(double latitude_1, double longitude_1, double latitude_2, double longitude_2);
+static size_t batch_buffers(const mp_obj_t* args, mp_buffer_info_t* buffers);
+static void geodetic_to_ecef(double latitude, double longitude, double altitude, double* ecef);
+static void enu_set_origin(enu_frame_t* frame, double latitude, double longitude, double altitude);
+static void enu_update(neo_m8_obj_t* self);
+static int32_t fix_height_mm(neo_m8_obj_t* self);
+static int64_t utc_now_us(neo_m8_obj_t* self);
+static void extrapolate_position(neo_m8_obj_t* self, int64_t utc_us, int32_t* output);
 static void get_sentence(neo_m8_obj_t *self, nmea_sentence_data_t* output, char* desired_sentence);
+static uint8_t split_nmea_sentence(char* sentence, char** fields, uint8_t max_fields);
+static int8_t gsv_talker_index(char first, char second);
+static void gsv_remove_talker(gsv_table_t* table, uint8_t talker);
+static void gsv_commit_talker(gsv_table_t* table, gsv_table_t* staging, uint8_t talker);
+static int8_t decode_gsv(neo_m8_obj_t* self, char* sentence, uint8_t length);
+static void decode_gsa(neo_m8_obj_t* self);
+static uint8_t fix_accepted(neo_m8_obj_t* self, uint8_t quality, uint8_t satellites_used, float pdop);
 
 static int8_t parse_gga(neo_m8_obj_t* self);
 static int8_t parse_rmc(neo_m8_obj_t* self);
 static int8_t parse_gsa(neo_m8_obj_t* self);
+static int8_t parse_pubx(neo_m8_obj_t* self);
+static void pubx_poll(neo_m8_obj_t* self);
+static void cfg_rate_write(neo_m8_obj_t* self, uint16_t meas_rate_ms, uint16_t nav_rate, uint16_t time_ref);
+static int8_t cfg_rate_read(neo_m8_obj_t* self);
+static uint16_t rate_to_meas_ms(mp_obj_t rate_in);
+static void rate_adapt(neo_m8_obj_t* self);
 
 extern const mp_obj_type_t neo_m8_type;
 
@@ -0,0 +1,407 @@
+#include "neo_m8_core.h"
+
+#include <string.h>
+
+static void pps_read(pps_t* pps, int64_t* latch_us, uint32_t* count){
+	/**
+	 * Reads the latest PPS edge consistently - the ISR could fire part-way through reading the 64-bit time
+	*/
+	do {
+		*count = pps->count;
+		*latch_us = pps->latch_us;
+	} while (*count != pps->count);
+}
+
+void IRAM_ATTR pps_edge(pps_t* pps, int64_t edge_us){
+	/**
+	 * Records a PPS timepulse edge at the given esp_timer time, unless it's too soon after the last one to be a real pulse
+	 * An extra edge would make every later pairing look a second early, and those are never accepted (see pps_pair())
+	*/
+	int64_t gap_us = edge_us - pps->latch_us;
+
+	if (pps->count != 0){
+		if (gap_us < PPS_MIN_EDGE_INTERVAL_US){
+			return;
+		}
+
+		// Counting any edges missed since the last one, so the time carries on from the same pairing
+		for (; (gap_us > PPS_MISSED_EDGE_US) && (gap_us < PPS_MAX_GAP_US); gap_us -= 1000000){
+			pps->count++;
+		}
+	}
+
+	pps->latch_us = edge_us;
+	pps->count++;
+}
+
+void pps_pair(pps_t* pps, int64_t received_us, int64_t utc_us){
+	/**
+	 * Pairs the latest PPS edge with the UTC second it marks, given a whole-second sentence's UTC time and when it arrived (esp_timer time)
+	 * The timepulse marks the start of each UTC second, and the epoch's NMEA sentences follow it - so a whole-second sentence read
+	 * less than a second after an edge carries that edge's UTC time, unless it was read late, after the next edge had already fired
+	*/
+	int64_t latch_us;
+	uint32_t count;
+
+	pps_read(pps, &latch_us, &count);
+
+	if ((count == 0) || (count == pps->paired_count)){
+		return;
+	}
+
+	if ((received_us < latch_us) || (received_us - latch_us > 1000000)){
+		return;
+	}
+
+	// A sentence read late is paired with an edge a second after its own, so it always puts the edge a second earlier than it is - and
+	// reads can be late every time (e.g. a loop that polls just after each edge). So a pairing that puts the edge earlier than the
+	// existing one is never taken, while a later one always is - the existing pairing was from a late read, or edges were missed
+	if ((pps->paired_count != 0) && (utc_us <= pps->utc_us + (int64_t)(count - pps->paired_count)*1000000)){
+		return;
+	}
+
+	pps->utc_us = utc_us;
+	pps->paired_count = count;
+}
+
+int64_t pps_utc_now(pps_t* pps, int64_t now_us){
+	/**
+	 * Interpolates the UTC time (microseconds since 1970-01-01) at the given esp_timer time from the latest PPS edge
+	 * Returns 0 if no edge has been paired with a UTC second yet
+	*/
+	int64_t latch_us;
+	uint32_t count;
+
+	if (pps->paired_count == 0){
+		return 0;
+	}
+
+	pps_read(pps, &latch_us, &count);
+
+	// Every edge since the paired one is another whole second
+	return pps->utc_us + (int64_t)(count - pps->paired_count)*1000000 + (now_us - latch_us);
+}
+
+void kalman_predict(kalman_t* filter, int64_t utc_us){
+	/**
+	 * Moves the Kalman filter's state forwards to a UTC time with the constant-velocity model
+	 * Process noise is white acceleration, so the covariance grows as dt^4/4, dt^3/2 and dt^2
+	*/
+	float dt, dt2, q;
+	uint8_t i;
+
+	// Measurements arriving out of order are applied at the filter's current time
+	if (utc_us <= filter->utc_us){
+		return;
+	}
+
+	dt = (utc_us - filter->utc_us) / 1e6f;
+	dt2 = dt*dt;
+	q = filter->acceleration_noise * filter->acceleration_noise;
+	filter->utc_us = utc_us;
+
+	for (i = 0; i < 3; i++){
+		kalman_axis_t* axis = &(filter->axes[i]);
+
+		axis->position += axis->velocity*dt;
+		axis->p00 += dt*(2*axis->p01 + dt*axis->p11) + q*dt2*dt2*0.25f;
+		axis->p01 += dt*axis->p11 + q*dt2*dt*0.5f;
+		axis->p11 += q*dt2;
+	}
+}
+
+void kalman_update_position(kalman_axis_t* axis, float measurement, float variance){
+	/**
+	 * Kalman filter measurement update of one axis with a position measurement
+	*/
+	float innovation = measurement - axis->position;
+	float k0 = axis->p00 / (axis->p00 + variance), k1 = axis->p01 / (axis->p00 + variance);
+
+	axis->position += k0*innovation;
+	axis->velocity += k1*innovation;
+
+	axis->p11 -= k1*axis->p01;
+	axis->p01 *= 1 - k0;
+	axis->p00 *= 1 - k0;
+}
+
+void kalman_update_velocity(kalman_axis_t* axis, float measurement, float variance){
+	/**
+	 * Kalman filter measurement update of one axis with a velocity measurement
+	*/
+	float innovation = measurement - axis->velocity;
+	float k0 = axis->p01 / (axis->p11 + variance), k1 = axis->p11 / (axis->p11 + variance);
+
+	axis->position += k0*innovation;
+	axis->velocity += k1*innovation;
+
+	axis->p00 -= k0*axis->p01;
+	axis->p01 *= 1 - k1;
+	axis->p11 *= 1 - k1;
+}
+
+static uint8_t varint_encode(int64_t value, uint8_t* output){
+	/**
+	 * Zigzag encodes a signed value (so small negative numbers stay small) then writes it as a little-endian base-128 varint
+	 * Returns the number of bytes written - up to 10
+	*/
+	uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	uint8_t length = 0;
+
+	while (zigzag >= 0x80){
+		output[length++] = (zigzag & 0x7F) | 0x80;
+		zigzag >>= 7;
+	}
+	output[length++] = zigzag;
+
+	return length;
+}
+
+static uint8_t track_encode(track_encoder_t* encoder, const fix_record_t* record, uint8_t keyframe, uint8_t* output){
+	/**
+	 * Encodes one fix for the track log: a tag byte, then time (ms), latitude, longitude (1e-7 degrees), altitude (mm) and speed (cm/s) as varints
+	 * Keyframes hold the absolute values, every other record holds the change since the previous fix
+	 * Returns the number of bytes written - up to TRACK_RECORD_MAX_LENGTH
+	*/
+	uint8_t length = 1;
+	int64_t utc_ms = record->utc_us / 1000;
+
+	if (keyframe){
+		output[0] = TRACK_TAG_KEYFRAME;
+		length += varint_encode(utc_ms, output + length);
+		length += varint_encode(record->latitude_e7, output + length);
+		length += varint_encode(record->longitude_e7, output + length);
+		length += varint_encode(record->altitude_mm, output + length);
+		length += varint_encode(record->speed_cms, output + length);
+	}
+	else {
+		output[0] = TRACK_TAG_DELTA;
+		length += varint_encode(utc_ms - encoder->last_utc_ms, output + length);
+		length += varint_encode((int64_t)(record->latitude_e7) - encoder->last_latitude_e7, output + length);
+		length += varint_encode((int64_t)(record->longitude_e7) - encoder->last_longitude_e7, output + length);
+		length += varint_encode((int64_t)(record->altitude_mm) - encoder->last_altitude_mm, output + length);
+		length += varint_encode((int32_t)(record->speed_cms) - encoder->last_speed_cms, output + length);
+	}
+
+	return length;
+}
+
+void track_start(track_encoder_t* encoder, uint8_t* block, uint16_t* block_length){
+	/**
+	 * Starts a track log - writes the file header to the start of the first block, and makes the first fix a keyframe
+	*/
+	memcpy(block, "NM8T", 4);
+	block[4] = TRACK_VERSION;
+	block[5] = 0x00;
+	block[6] = TRACK_BLOCK_LENGTH & 0xFF;
+	block[7] = TRACK_BLOCK_LENGTH >> 8;
+	*block_length = TRACK_HEADER_LENGTH;
+
+	encoder->since_keyframe = 0;
+}
+
+uint8_t track_append(track_encoder_t* encoder, const fix_record_t* record, uint8_t* block, uint16_t* block_length){
+	/**
+	 * Appends a fix to a track log block - a keyframe if it's the first in the block or one is due, otherwise the change since the last fix
+	 * Returns 1 if all good, 0 if it doesn't fit - the block then needs writing out (see track_pad_block()), and the fix appending to the next
+	*/
+	uint8_t encoded[TRACK_RECORD_MAX_LENGTH];
+	uint8_t keyframe = (*block_length == 0) || (encoder->since_keyframe == 0);
+	uint8_t length = track_encode(encoder, record, keyframe, encoded);
+
+	if (length > TRACK_BLOCK_LENGTH - *block_length){
+		return 0;
+	}
+
+	memcpy(block + *block_length, encoded, length);
+	*block_length += length;
+	encoder->since_keyframe = keyframe ? 1 : (encoder->since_keyframe + 1) % TRACK_KEYFRAME_INTERVAL;
+
+	encoder->last_utc_ms = record->utc_us / 1000;
+	encoder->last_latitude_e7 = record->latitude_e7;
+	encoder->last_longitude_e7 = record->longitude_e7;
+	encoder->last_altitude_mm = record->altitude_mm;
+	encoder->last_speed_cms = record->speed_cms;
+
+	return 1;
+}
+
+void track_pad_block(uint8_t* block, uint16_t block_length){
+	/**
+	 * Pads a track log block out to TRACK_BLOCK_LENGTH with TRACK_TAG_PADDING, ready to be written
+	*/
+	memset(block + block_length, TRACK_TAG_PADDING, TRACK_BLOCK_LENGTH - block_length);
+}
+
+uint8_t geofence_project(const geofence_set_t* set, int32_t latitude_e7, int32_t longitude_e7, int32_t* x, int32_t* y){
+	/**
+	 * Projects a position onto the geofences' local east/north plane, in mm from the origin
+	 * Returns 1 if all good, 0 if it's more than GEOFENCE_MAX_RANGE_MM from the origin
+	*/
+	int64_t longitude_difference = (int64_t)longitude_e7 - set->origin_longitude_e7;
+	int64_t east, north;
+
+	// Taking the short way round the antimeridian
+	if (longitude_difference > 1800000000LL){
+		longitude_difference -= 3600000000LL;
+	}
+	else if (longitude_difference < -1800000000LL){
+		longitude_difference += 3600000000LL;
+	}
+
+	east = longitude_difference * set->origin_lon_mm_per_degree / 10000000;
+	north = ((int64_t)latitude_e7 - set->origin_latitude_e7) * MM_PER_DEGREE / 10000000;
+
+	if ((east > GEOFENCE_MAX_RANGE_MM) || (east < -GEOFENCE_MAX_RANGE_MM) || (north > GEOFENCE_MAX_RANGE_MM) || (north < -GEOFENCE_MAX_RANGE_MM)){
+		return 0;
+	}
+
+	*x = east;
+	*y = north;
+
+	return 1;
+}
+
+static uint8_t geofence_edge_buckets(const geofence_polygon_t* polygon, const int32_t* vertices, uint16_t edge, uint8_t* first_bucket,
+                                     uint8_t* last_bucket){
+	/**
+	 * Works out the range of a polygon's y buckets an edge spans
+	 * Returns 1 if all good, 0 for a horizontal edge - it can never be crossed, so is left out of the index
+	*/
+	uint16_t next = (edge + 1 == polygon->vertex_count) ? 0 : edge + 1;
+	int64_t height = (int64_t)(polygon->max_y) - polygon->min_y + 1;
+	int32_t low, high;
+
+	if (vertices[2*edge + 1] == vertices[2*next + 1]){
+		return 0;
+	}
+
+	low = (vertices[2*edge + 1] < vertices[2*next + 1]) ? vertices[2*edge + 1] : vertices[2*next + 1];
+	high = (vertices[2*edge + 1] < vertices[2*next + 1]) ? vertices[2*next + 1] : vertices[2*edge + 1];
+	*first_bucket = ((int64_t)low - polygon->min_y) * polygon->bucket_count / height;
+	*last_bucket = ((int64_t)high - polygon->min_y) * polygon->bucket_count / height;
+
+	return 1;
+}
+
+uint32_t geofence_prepare(const geofence_set_t* set, geofence_polygon_t* polygon){
+	/**
+	 * Works out a polygon's bounding box and number of y buckets from its (projected) vertices
+	 * Returns how many entries its edge index will take in the shared pool - the caller makes room for those, and for bucket_count + 1
+	 * offsets, before geofence_build_index()
+	*/
+	const int32_t* vertices = set->vertices + 2*polygon->first_vertex;
+	uint32_t total = 0;
+	uint16_t i;
+	uint8_t first_bucket, last_bucket;
+
+	polygon->min_x = polygon->max_x = vertices[0];
+	polygon->min_y = polygon->max_y = vertices[1];
+
+	for (i = 1; i < polygon->vertex_count; i++){
+		polygon->min_x = (vertices[2*i] < polygon->min_x) ? vertices[2*i] : polygon->min_x;
+		polygon->max_x = (vertices[2*i] > polygon->max_x) ? vertices[2*i] : polygon->max_x;
+		polygon->min_y = (vertices[2*i + 1] < polygon->min_y) ? vertices[2*i + 1] : polygon->min_y;
+		polygon->max_y = (vertices[2*i + 1] > polygon->max_y) ? vertices[2*i + 1] : polygon->max_y;
+	}
+
+	polygon->bucket_count = (polygon->vertex_count + GEOFENCE_EDGES_PER_BUCKET - 1) / GEOFENCE_EDGES_PER_BUCKET;
+	if (polygon->bucket_count > GEOFENCE_MAX_BUCKETS){
+		polygon->bucket_count = GEOFENCE_MAX_BUCKETS;
+	}
+
+	for (i = 0; i < polygon->vertex_count; i++){
+		if (geofence_edge_buckets(polygon, vertices, i, &first_bucket, &last_bucket)){
+			total += last_bucket - first_bucket + 1;
+		}
+	}
+
+	return total;
+}
+
+void geofence_build_index(geofence_set_t* set, geofence_polygon_t* polygon){
+	/**
+	 * Splits a polygon's y range into buckets, and lists in each bucket the edges that span it
+	 * A point-in-polygon test then only has to look at the edges in the point's bucket
+	 * The polygon must have been through geofence_prepare(), and the shared pools must have room for what it returned
+	*/
+	const int32_t* vertices = set->vertices + 2*polygon->first_vertex;
+	uint32_t* offsets;
+	uint32_t total = 0, count;
+	uint16_t edge;
+	uint8_t bucket, first_bucket, last_bucket;
+
+	polygon->first_offset = set->offset_count;
+	set->offset_count += polygon->bucket_count + 1;
+	offsets = set->bucket_offsets + polygon->first_offset;
+	memset(offsets, 0, (polygon->bucket_count + 1)*sizeof(uint32_t));
+
+	// First pass counts the edges in each bucket
+	for (edge = 0; edge < polygon->vertex_count; edge++){
+		if (geofence_edge_buckets(polygon, vertices, edge, &first_bucket, &last_bucket)){
+			for (bucket = first_bucket; bucket <= last_bucket; bucket++){
+				offsets[bucket + 1]++;
+			}
+		}
+	}
+
+	// Turning the counts into start positions in the shared edge pool
+	for (bucket = 0; bucket < polygon->bucket_count; bucket++){
+		count = offsets[bucket + 1];
+		offsets[bucket] = set->edge_count + total;
+		total += count;
+	}
+	offsets[polygon->bucket_count] = set->edge_count + total;
+
+	// Second pass fills the buckets, using each bucket's start as a cursor - which leaves it pointing at the next bucket's start
+	for (edge = 0; edge < polygon->vertex_count; edge++){
+		if (geofence_edge_buckets(polygon, vertices, edge, &first_bucket, &last_bucket)){
+			for (bucket = first_bucket; bucket <= last_bucket; bucket++){
+				set->bucket_edges[offsets[bucket]++] = edge;
+			}
+		}
+	}
+
+	for (bucket = polygon->bucket_count; bucket > 0; bucket--){
+		offsets[bucket] = offsets[bucket - 1];
+	}
+	offsets[0] = set->edge_count;
+
+	set->edge_count += total;
+}
+
+uint8_t geofence_contains(const geofence_set_t* set, const geofence_polygon_t* polygon, int32_t x, int32_t y){
+	/**
+	 * Point-in-polygon test by ray casting (even-odd rule), only looking at the edges in the point's y bucket
+	 * Returns 1 if the point is inside, 0 if not
+	*/
+	const int32_t* vertices = set->vertices + 2*polygon->first_vertex;
+	const uint32_t* offsets = set->bucket_offsets + polygon->first_offset;
+	uint32_t i;
+	uint16_t edge, next;
+	uint8_t bucket, inside = 0;
+	int64_t crossing, point;
+
+	if ((x < polygon->min_x) || (x > polygon->max_x) || (y < polygon->min_y) || (y > polygon->max_y)){
+		return 0;
+	}
+
+	bucket = ((int64_t)y - polygon->min_y) * polygon->bucket_count / ((int64_t)(polygon->max_y) - polygon->min_y + 1);
+
+	for (i = offsets[bucket]; i < offsets[bucket + 1]; i++){
+		edge = set->bucket_edges[i];
+		next = (edge + 1 == polygon->vertex_count) ? 0 : edge + 1;
+
+		if ((vertices[2*edge + 1] > y) != (vertices[2*next + 1] > y)){
+			// Checking if the edge crosses the ray east of the point, cross-multiplied to avoid dividing
+			crossing = ((int64_t)(vertices[2*next]) - vertices[2*edge]) * ((int64_t)y - vertices[2*edge + 1]);
+			point = ((int64_t)x - vertices[2*edge]) * ((int64_t)(vertices[2*next + 1]) - vertices[2*edge + 1]);
+
+			if ((vertices[2*next + 1] > vertices[2*edge + 1]) ? (crossing > point) : (crossing < point)){
+				inside ^= 1;
+			}
+		}
+	}
+
+	return inside;
+}
@@ -0,0 +1,143 @@
+#ifndef NEO_M8_CORE_H
+#define NEO_M8_CORE_H
+
+// The parts of the driver that are plain C (no MicroPython or ESP-IDF calls), so they can be built and checked on a host - see tools/
+
+#include <stdint.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#else
+#define IRAM_ATTR
+#endif
+
+// Timepulse edges closer together than this are taken as glitches and ignored - the pulse is once a second
+#define PPS_MIN_EDGE_INTERVAL_US 900000
+// A gap of more than PPS_MISSED_EDGE_US between edges means edges were missed, and each extra second is counted - up to PPS_MAX_GAP_US,
+// beyond which (e.g. the timepulse was off) the next pairing puts the count right instead, keeping the ISR short
+#define PPS_MISSED_EDGE_US 1500000
+#define PPS_MAX_GAP_US 10000000
+
+// Binary track log format - see tools/track_decode.py
+#define TRACK_BLOCK_LENGTH 4096
+#define TRACK_HEADER_LENGTH 8
+#define TRACK_VERSION 1
+#define TRACK_KEYFRAME_INTERVAL 60
+#define TRACK_RECORD_MAX_LENGTH 32
+#define TRACK_TAG_DELTA 0x00
+#define TRACK_TAG_KEYFRAME 0x01
+#define TRACK_TAG_PADDING 0xFF
+
+// Millimetres per degree of latitude (and of longitude at the equator), from the WGS84 equatorial radius
+#define MM_PER_DEGREE 111319491
+
+#define GEOFENCE_MAX_RANGE_MM 1000000000
+#define GEOFENCE_EDGES_PER_BUCKET 4
+#define GEOFENCE_MAX_BUCKETS 64
+#define GEOFENCE_EVENT_LENGTH 32
+
+// PPS timepulse - the latch is written by the GPIO ISR, and paired with the UTC second it marks once that epoch's sentences arrive
+typedef struct {
+    volatile int64_t latch_us;
+    volatile uint32_t count;
+    uint32_t paired_count;
+    int64_t utc_us;
+} pps_t;
+
+// Struct for one axis of the constant-velocity Kalman filter - position/velocity state and its (symmetric) covariance
+typedef struct {
+    float position;
+    float velocity;
+    float p00;
+    float p01;
+    float p11;
+} kalman_axis_t;
+
+// Struct to hold the Kalman filter - east/north/up axes in the local tangent plane
+typedef struct {
+    kalman_axis_t axes[3];
+    float acceleration_noise;
+    int64_t utc_us;
+    uint8_t enabled;
+    uint8_t initialised;
+} kalman_t;
+
+// Packed record of one fix in the history ring - laid out as struct format "<qiiiH" for micropython
+typedef struct __attribute__((packed)) {
+    int64_t utc_us;
+    int32_t latitude_e7;
+    int32_t longitude_e7;
+    int32_t altitude_mm;
+    uint16_t speed_cms;
+} fix_record_t;
+
+// Struct to hold the track log encoder - the last fix logged, which the next record holds the change from
+typedef struct {
+    uint8_t since_keyframe;
+    int64_t last_utc_ms;
+    int32_t last_latitude_e7;
+    int32_t last_longitude_e7;
+    int32_t last_altitude_mm;
+    int32_t last_speed_cms;
+} track_encoder_t;
+
+// Struct for one geofence polygon - its vertices, and its edges bucketed by y, live in the geofence set's shared pools
+typedef struct {
+    int32_t id;
+    uint32_t first_vertex;
+    uint32_t first_offset;
+    uint16_t vertex_count;
+    uint8_t bucket_count;
+    uint8_t inside;
+    int32_t min_x;
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+} geofence_polygon_t;
+
+typedef struct {
+    int32_t id;
+    uint8_t entered;
+} geofence_event_t;
+
+// Struct to hold every geofence, projected into a local east/north frame (mm) centred on the first vertex added
+typedef struct {
+    geofence_polygon_t* polygons;
+    int32_t* vertices;
+    uint32_t* bucket_offsets;
+    uint16_t* bucket_edges;
+    uint16_t count;
+    uint16_t capacity;
+    uint32_t vertex_count;
+    uint32_t vertex_capacity;
+    uint32_t offset_count;
+    uint32_t offset_capacity;
+    uint32_t edge_count;
+    uint32_t edge_capacity;
+
+    int32_t origin_latitude_e7;
+    int32_t origin_longitude_e7;
+    int32_t origin_lon_mm_per_degree;
+
+    // Enter/exit events waiting for geofence_check(), oldest overwritten first
+    geofence_event_t events[GEOFENCE_EVENT_LENGTH];
+    uint8_t event_head;
+    uint8_t event_count;
+} geofence_set_t;
+
+// Function declarations
+void pps_edge(pps_t* pps, int64_t edge_us);
+void pps_pair(pps_t* pps, int64_t received_us, int64_t utc_us);
+int64_t pps_utc_now(pps_t* pps, int64_t now_us);
+void kalman_predict(kalman_t* filter, int64_t utc_us);
+void kalman_update_position(kalman_axis_t* axis, float measurement, float variance);
+void kalman_update_velocity(kalman_axis_t* axis, float measurement, float variance);
+void track_start(track_encoder_t* encoder, uint8_t* block, uint16_t* block_length);
+uint8_t track_append(track_encoder_t* encoder, const fix_record_t* record, uint8_t* block, uint16_t* block_length);
+void track_pad_block(uint8_t* block, uint16_t block_length);
+uint8_t geofence_project(const geofence_set_t* set, int32_t latitude_e7, int32_t longitude_e7, int32_t* x, int32_t* y);
+uint32_t geofence_prepare(const geofence_set_t* set, geofence_polygon_t* polygon);
+void geofence_build_index(geofence_set_t* set, geofence_polygon_t* polygon);
+uint8_t geofence_contains(const geofence_set_t* set, const geofence_polygon_t* polygon, int32_t x, int32_t y);
+
+#endif
@@ -0,0 +1,259 @@
+/**
+ * Host-side benchmark of the C module's geofence engine (geofence_project(), geofence_prepare(), geofence_build_index() and
+ * geofence_contains() in neo_m8_core.c), checked against a naive ray cast
+ *
+ * Build and run from the repository root:
+ *     cc -O2 -Iembedded_c_module tools/geofence_bench.c embedded_c_module/neo_m8_core.c -lm -o geofence_bench
+ *     ./geofence_bench [polygons] [points] [max_vertices]
+ *
+ * Defaults to 1000 polygons and 10000 points. The polygons are random star shapes (3 to max_vertices vertices, 64 by default, some of
+ * them with concave notches) 200m-5km across, scattered over a 50km square - so a point falls inside one or two of them on average.
+ * They're added the way geofence_add() does: projected onto the local plane around the first vertex, then indexed into shared pools.
+ * The points are random positions over the same square. Each point is checked against every polygon the way geofence_fix() does (one
+ * projection, then geofence_contains() for each polygon), and by a naive ray cast over every edge with no bounding box or buckets.
+ * Exits with 1 if any answer differs. Times are the best of five passes, and are host timings, not ESP32 ones.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "neo_m8_core.h"
+
+#define PASSES 5
+#define CENTRE_LATITUDE 52.2053
+#define CENTRE_LONGITUDE 0.1218
+#define AREA_M 50000.0
+#define MIN_RADIUS_M 100.0
+#define MAX_RADIUS_M 2500.0
+
+static uint64_t random_state = 0x47454F46;
+
+static double random_uniform(void){
+	// xorshift64, in [0, 1)
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+
+	return (random_state >> 11) / 9007199254740992.0;
+}
+
+static double now_ns(void){
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return time.tv_sec*1e9 + time.tv_nsec;
+}
+
+static void random_position(double centre_north_m, double centre_east_m, double spread_m, int32_t* latitude_e7, int32_t* longitude_e7){
+	// A position in 1e-7 degrees, up to spread_m from a point given in metres from the centre of the area
+	double lon_mm_per_degree = MM_PER_DEGREE * cos(CENTRE_LATITUDE * 0.017453292519943295);
+
+	*latitude_e7 = llround(CENTRE_LATITUDE*1e7 + (centre_north_m + spread_m*(2*random_uniform() - 1)) * 1e3 * 1e7 / MM_PER_DEGREE);
+	*longitude_e7 = llround(CENTRE_LONGITUDE*1e7 + (centre_east_m + spread_m*(2*random_uniform() - 1)) * 1e3 * 1e7 / lon_mm_per_degree);
+}
+
+static uint8_t naive_contains(const int32_t* vertices, uint16_t vertex_count, int32_t x, int32_t y){
+	// Textbook even-odd ray cast over every edge - x is compared with each crossing exactly, as a fraction
+	uint8_t inside = 0;
+	uint16_t i, j;
+	int64_t dy;
+	__int128 left, right;
+
+	for (i = 0, j = vertex_count - 1; i < vertex_count; j = i++){
+		if ((vertices[2*i + 1] > y) == (vertices[2*j + 1] > y)){
+			continue;
+		}
+
+		// x < xi + (xj - xi)*(y - yi)/(yj - yi), with both sides multiplied by |yj - yi|
+		dy = (int64_t)(vertices[2*j + 1]) - vertices[2*i + 1];
+		left = (__int128)((int64_t)x - vertices[2*i]) * dy;
+		right = (__int128)((int64_t)(vertices[2*j]) - vertices[2*i]) * ((int64_t)y - vertices[2*i + 1]);
+
+		if ((dy > 0) ? (left < right) : (left > right)){
+			inside ^= 1;
+		}
+	}
+
+	return inside;
+}
+
+int main(int argc, char** argv){
+	long polygon_count = (argc > 1) ? atol(argv[1]) : 1000;
+	long point_count = (argc > 2) ? atol(argv[2]) : 10000;
+	long max_vertices = (argc > 3) ? atol(argv[3]) : 64;
+	long p, q, mismatches = 0, inside_count = 0;
+	geofence_set_t set;
+	geofence_polygon_t* polygon;
+	int32_t* points;
+	uint8_t* indexed_results;
+	uint8_t* naive_results;
+	int32_t latitude_e7, longitude_e7, x, y;
+	uint32_t edge_total;
+	uint16_t vertex_count, i;
+	double centre_north_m, centre_east_m, radius_m, angle, scale, start_ns, pass_ns;
+	double build_ns = 1e30, indexed_ns = 1e30, naive_ns = 1e30;
+	int pass;
+
+	if ((max_vertices < 3) || (max_vertices > UINT16_MAX)){
+		printf("max_vertices must be between 3 and 65535\n");
+		return 1;
+	}
+
+	memset(&set, 0, sizeof(geofence_set_t));
+	set.polygons = malloc(polygon_count * sizeof(geofence_polygon_t));
+	set.vertices = malloc(2 * polygon_count * max_vertices * sizeof(int32_t));
+	// At most GEOFENCE_MAX_BUCKETS entries per edge, and GEOFENCE_MAX_BUCKETS + 1 offsets per polygon
+	set.bucket_offsets = malloc(polygon_count * (GEOFENCE_MAX_BUCKETS + 1) * sizeof(uint32_t));
+	set.bucket_edges = malloc(polygon_count * max_vertices * GEOFENCE_MAX_BUCKETS * sizeof(uint16_t));
+	points = malloc(2 * point_count * sizeof(int32_t));
+	indexed_results = malloc(polygon_count * point_count);
+	naive_results = malloc(polygon_count * point_count);
+
+	if ((set.polygons == NULL) || (set.vertices == NULL) || (set.bucket_offsets == NULL) || (set.bucket_edges == NULL) || (points == NULL)
+	    || (indexed_results == NULL) || (naive_results == NULL)){
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	// Projecting every polygon's vertices, as geofence_add() does - the first vertex becomes the origin of the local plane
+	for (p = 0; p < polygon_count; p++){
+		centre_north_m = AREA_M * (random_uniform() - 0.5);
+		centre_east_m = AREA_M * (random_uniform() - 0.5);
+		radius_m = MIN_RADIUS_M + (MAX_RADIUS_M - MIN_RADIUS_M) * random_uniform();
+		vertex_count = 3 + (uint16_t)(random_uniform() * (max_vertices - 2));
+
+		polygon = &(set.polygons[p]);
+		polygon->id = p;
+		polygon->first_vertex = set.vertex_count;
+		polygon->vertex_count = vertex_count;
+		polygon->inside = 0;
+
+		for (i = 0; i < vertex_count; i++){
+			// Going round the centre, each vertex at a random distance - a deep notch now and then
+			angle = 6.283185307179586 * (i + 0.8*random_uniform()) / vertex_count;
+			scale = (random_uniform() < 0.1) ? 0.2 : 0.6 + 0.4*random_uniform();
+			random_position(centre_north_m + radius_m*scale*cos(angle), centre_east_m + radius_m*scale*sin(angle), 0, &latitude_e7,
+			                &longitude_e7);
+
+			if ((p == 0) && (i == 0)){
+				set.origin_latitude_e7 = latitude_e7;
+				set.origin_longitude_e7 = longitude_e7;
+				set.origin_lon_mm_per_degree = MM_PER_DEGREE * cosf(latitude_e7 / 1e7f * 0.0174532925f);
+			}
+
+			if (geofence_project(&set, latitude_e7, longitude_e7, &x, &y) != 1){
+				printf("Vertex out of range\n");
+				return 1;
+			}
+
+			set.vertices[2*(set.vertex_count + i)] = x;
+			set.vertices[2*(set.vertex_count + i) + 1] = y;
+		}
+
+		set.vertex_count += vertex_count;
+	}
+	set.count = set.capacity = polygon_count;
+
+	// Indexing every polygon - the pools are allocated up front, so only the index building is timed
+	for (pass = 0; pass < PASSES; pass++){
+		set.offset_count = 0;
+		set.edge_count = 0;
+
+		start_ns = now_ns();
+
+		for (p = 0; p < polygon_count; p++){
+			edge_total = geofence_prepare(&set, &(set.polygons[p]));
+
+			if (edge_total > (uint32_t)(set.polygons[p].vertex_count) * GEOFENCE_MAX_BUCKETS){
+				printf("Polygon %ld needs more edge entries than expected\n", p);
+				return 1;
+			}
+
+			geofence_build_index(&set, &(set.polygons[p]));
+		}
+
+		pass_ns = now_ns() - start_ns;
+		build_ns = (pass_ns < build_ns) ? pass_ns : build_ns;
+	}
+
+	for (q = 0; q < point_count; q++){
+		random_position(0, 0, AREA_M / 2, &points[2*q], &points[2*q + 1]);
+	}
+
+	// Every point against every polygon the way geofence_fix() does it
+	for (pass = 0; pass < PASSES; pass++){
+		start_ns = now_ns();
+
+		for (q = 0; q < point_count; q++){
+			if (geofence_project(&set, points[2*q], points[2*q + 1], &x, &y) != 1){
+				memset(indexed_results + q*polygon_count, 0, polygon_count);
+				continue;
+			}
+
+			for (p = 0; p < polygon_count; p++){
+				indexed_results[q*polygon_count + p] = geofence_contains(&set, &(set.polygons[p]), x, y);
+			}
+		}
+
+		pass_ns = now_ns() - start_ns;
+		indexed_ns = (pass_ns < indexed_ns) ? pass_ns : indexed_ns;
+	}
+
+	// And with the naive ray cast
+	for (pass = 0; pass < PASSES; pass++){
+		start_ns = now_ns();
+
+		for (q = 0; q < point_count; q++){
+			if (geofence_project(&set, points[2*q], points[2*q + 1], &x, &y) != 1){
+				memset(naive_results + q*polygon_count, 0, polygon_count);
+				continue;
+			}
+
+			for (p = 0; p < polygon_count; p++){
+				polygon = &(set.polygons[p]);
+				naive_results[q*polygon_count + p] = naive_contains(set.vertices + 2*polygon->first_vertex, polygon->vertex_count, x, y);
+			}
+		}
+
+		pass_ns = now_ns() - start_ns;
+		naive_ns = (pass_ns < naive_ns) ? pass_ns : naive_ns;
+	}
+
+	for (q = 0; q < point_count; q++){
+		for (p = 0; p < polygon_count; p++){
+			inside_count += naive_results[q*polygon_count + p];
+
+			if (indexed_results[q*polygon_count + p] != naive_results[q*polygon_count + p]){
+				if (mismatches < 10){
+					printf("point %ld, polygon %ld: indexed says %s, naive says %s\n", q, p, indexed_results[q*polygon_count + p] ? "inside" : "outside",
+					       naive_results[q*polygon_count + p] ? "inside" : "outside");
+				}
+				mismatches++;
+			}
+		}
+	}
+
+	printf("%ld polygons (%lu vertices, %lu indexed edge entries), %ld points, %.2f polygons containing each point on average\n",
+	       polygon_count, (unsigned long)set.vertex_count, (unsigned long)set.edge_count, point_count, (double)inside_count / point_count);
+	printf("Index build: %.1f us per polygon\n", build_ns / polygon_count / 1e3);
+	printf("Indexed: %.1f us per point against every polygon, %.1f ns per point-polygon check\n", indexed_ns / point_count / 1e3,
+	       indexed_ns / point_count / polygon_count);
+	printf("Naive:   %.1f us per point against every polygon, %.1f ns per point-polygon check (%.1fx slower)\n", naive_ns / point_count / 1e3,
+	       naive_ns / point_count / polygon_count, naive_ns / indexed_ns);
+	printf("%ld mismatches against the naive ray cast\n%s\n", mismatches, mismatches ? "FAIL" : "OK");
+
+	free(set.polygons);
+	free(set.vertices);
+	free(set.bucket_offsets);
+	free(set.bucket_edges);
+	free(points);
+	free(indexed_results);
+	free(naive_results);
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * Host-side benchmark of the C module's Kalman filter step (kalman_predict(), kalman_update_position() and kalman_update_velocity() in
+ * neo_m8_core.c)
+ *
+ * Build and run from the repository root:
+ *     cc -O2 -Iembedded_c_module tools/kalman_bench.c embedded_c_module/neo_m8_core.c -lm -o kalman_bench && ./kalman_bench [epochs]
+ *
+ * A receiver moving with random accelerations (damped, and pulled back towards the origin, so it stays within a few km like a local
+ * tangent plane track would) is sampled at 10Hz. Its position is measured with 2.5m (horizontal)/5m (vertical) 1 sigma noise,
+ * and its velocity with 0.5m/s noise. The measurements are generated up front, so only the filter is timed. Each epoch is what the driver runs
+ * per fix: one predict (all three axes), three position updates and three velocity updates. The time per epoch and per axis is the best of
+ * five passes. The filtered position error is also compared with the raw measurements' error, to show the filter does its job.
+ *
+ * These are host timings, not ESP32 ones. The step is a few dozen float32 multiply/adds and four divisions per axis, with no branches
+ * apart from the out-of-order check, so it scales with the target's single precision FPU throughput.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "neo_m8_core.h"
+
+#define EPOCH_US 100000
+#define PASSES 5
+#define HORIZONTAL_SIGMA 2.5f
+#define VERTICAL_SIGMA 5.0f
+#define VELOCITY_SIGMA 0.5f
+#define ACCELERATION_SIGMA 2.0f
+#define VELOCITY_DAMPING_S 30.0f
+#define ORIGIN_PULL_S 300.0f
+
+static uint64_t random_state = 0x4B414C4D;
+
+static float random_normal(void){
+	// Box-Muller transform over xorshift64
+	double u1, u2;
+
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	u1 = ((random_state >> 11) + 1.0) / 9007199254740993.0;
+
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	u2 = (random_state >> 11) / 9007199254740992.0;
+
+	return sqrt(-2*log(u1)) * cos(6.283185307179586*u2);
+}
+
+static void filter_start(kalman_t* filter, const float* first_position){
+	// Starting the filter from the first fix, as kalman_position_fix() does
+	uint8_t axis;
+
+	filter->acceleration_noise = ACCELERATION_SIGMA;
+	filter->utc_us = 0;
+	filter->enabled = 1;
+	filter->initialised = 1;
+
+	for (axis = 0; axis < 3; axis++){
+		filter->axes[axis].position = first_position[axis];
+		filter->axes[axis].velocity = 0;
+		filter->axes[axis].p00 = (axis == 2) ? VERTICAL_SIGMA*VERTICAL_SIGMA : HORIZONTAL_SIGMA*HORIZONTAL_SIGMA;
+		filter->axes[axis].p01 = 0;
+		filter->axes[axis].p11 = VELOCITY_SIGMA*VELOCITY_SIGMA*100;
+	}
+}
+
+static double now_ns(void){
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return time.tv_sec*1e9 + time.tv_nsec;
+}
+
+int main(int argc, char** argv){
+	long epochs = (argc > 1) ? atol(argv[1]) : 200000;
+	float* truth = malloc(epochs * 3 * sizeof(float));
+	float* positions = malloc(epochs * 3 * sizeof(float));
+	float* velocities = malloc(epochs * 3 * sizeof(float));
+	float velocity[3] = {0, 0, 0}, position[3] = {0, 0, 0}, dt = EPOCH_US / 1e6f;
+	float error;
+	double raw_squared = 0, filtered_squared = 0, start_ns, pass_ns, best_ns = 1e30;
+	volatile float sink = 0;
+	kalman_t filter;
+	long epoch;
+	int pass, axis;
+
+	if ((truth == NULL) || (positions == NULL) || (velocities == NULL)){
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	// Generating the track and its measurements
+	for (epoch = 0; epoch < epochs; epoch++){
+		for (axis = 0; axis < 3; axis++){
+			velocity[axis] += (ACCELERATION_SIGMA * random_normal() - velocity[axis] / VELOCITY_DAMPING_S
+			                   - position[axis] / (ORIGIN_PULL_S*ORIGIN_PULL_S)) * dt;
+			position[axis] += velocity[axis] * dt;
+
+			truth[3*epoch + axis] = position[axis];
+			positions[3*epoch + axis] = position[axis] + ((axis == 2) ? VERTICAL_SIGMA : HORIZONTAL_SIGMA) * random_normal();
+			velocities[3*epoch + axis] = velocity[axis] + VELOCITY_SIGMA * random_normal();
+		}
+	}
+
+	for (pass = 0; pass < PASSES; pass++){
+		filter_start(&filter, positions);
+
+		start_ns = now_ns();
+
+		for (epoch = 1; epoch < epochs; epoch++){
+			kalman_predict(&filter, epoch*(int64_t)EPOCH_US);
+
+			kalman_update_position(&(filter.axes[0]), positions[3*epoch], HORIZONTAL_SIGMA*HORIZONTAL_SIGMA);
+			kalman_update_position(&(filter.axes[1]), positions[3*epoch + 1], HORIZONTAL_SIGMA*HORIZONTAL_SIGMA);
+			kalman_update_position(&(filter.axes[2]), positions[3*epoch + 2], VERTICAL_SIGMA*VERTICAL_SIGMA);
+
+			kalman_update_velocity(&(filter.axes[0]), velocities[3*epoch], VELOCITY_SIGMA*VELOCITY_SIGMA);
+			kalman_update_velocity(&(filter.axes[1]), velocities[3*epoch + 1], VELOCITY_SIGMA*VELOCITY_SIGMA);
+			kalman_update_velocity(&(filter.axes[2]), velocities[3*epoch + 2], VELOCITY_SIGMA*VELOCITY_SIGMA);
+
+			sink += filter.axes[0].position;
+		}
+
+		pass_ns = now_ns() - start_ns;
+		best_ns = (pass_ns < best_ns) ? pass_ns : best_ns;
+	}
+
+	// Checking the accuracy on one more pass, untimed - skipping the first 100 epochs while the filter settles
+	filter_start(&filter, positions);
+
+	for (epoch = 1; epoch < epochs; epoch++){
+		kalman_predict(&filter, epoch*(int64_t)EPOCH_US);
+
+		for (axis = 0; axis < 3; axis++){
+			kalman_update_position(&(filter.axes[axis]), positions[3*epoch + axis],
+			                       (axis == 2) ? VERTICAL_SIGMA*VERTICAL_SIGMA : HORIZONTAL_SIGMA*HORIZONTAL_SIGMA);
+			kalman_update_velocity(&(filter.axes[axis]), velocities[3*epoch + axis], VELOCITY_SIGMA*VELOCITY_SIGMA);
+		}
+
+		if (epoch < 100){
+			continue;
+		}
+
+		for (axis = 0; axis < 2; axis++){
+			error = positions[3*epoch + axis] - truth[3*epoch + axis];
+			raw_squared += error*error;
+			error = filter.axes[axis].position - truth[3*epoch + axis];
+			filtered_squared += error*error;
+		}
+	}
+
+	printf("%ld epochs, best of %d passes: %.1f ns per epoch (predict + 3 position + 3 velocity updates), %.1f ns per axis\n",
+	       epochs, PASSES, best_ns / (epochs - 1), best_ns / (epochs - 1) / 3);
+	printf("Horizontal RMS error per axis: raw %.2f m, filtered %.2f m\n",
+	       sqrt(raw_squared / (2.0*(epochs - 100))), sqrt(filtered_squared / (2.0*(epochs - 100))));
+
+	free(truth);
+	free(positions);
+	free(velocities);
+
+	return (sink == 12345.0f) ? 2 : 0;
+}
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+Duty-cycle estimate of fixes per joule for the C module's power modes (set_power_mode()) and power_sleep().
+
+Usage: python3 tools/power_estimate.py [mode update_period_ms [on_time]] [name=value ...]
+
+This is an estimate from a model, not a measurement. Each fix period is split into phases, each at an assumed supply current, for the
+receiver and the ESP32 separately:
+  - continuous (0): the receiver tracks at full power all the time, and gets a fix every update period
+  - cyclic tracking (1): the receiver is fully on for cyclic_on_ms each update period, and in power optimised tracking for the rest
+  - ON/OFF (2): each update period, the receiver hot starts (hot_start_s), stays on for on_time seconds, then is off until the next
+    one - once the period is no longer than the time it's on, it's effectively continuous
+  - the ESP32 is either awake all the time (polling the module), or with power_sleep() awake only for the guard time, the burst of
+    sentences at the UART's baud rate, and processing_ms - light-sleeping for the rest. power_sleep() doesn't sleep in continuous mode
+Fixes per joule are the fixes per second over the average power (sum of current x supply voltage). Regulator losses aren't included.
+
+Every assumption below can be overridden with name=value, e.g. esp32_awake_ma=40 - they are typical datasheet-level figures for a
+NEO-M8 module and an ESP32 without WiFi/Bluetooth, and should be replaced with a module's own datasheet figures, or measurements, when
+they're known. With no mode given, prints a table for a few common configurations.
+"""
+
+import sys
+
+ASSUMPTIONS = {
+    "supply_v": 3.3,
+    # Receiver (NEO-M8, GPS+GLONASS) supply currents in mA
+    "acquisition_ma": 25.0,
+    "tracking_ma": 23.0,
+    # Power optimised tracking between cyclic tracking ON phases - 1mA makes 1Hz cyclic tracking average around 5.4mA, close to the
+    # NEO-M8 datasheet's power save mode figure
+    "cyclic_idle_ma": 1.0,
+    "cyclic_on_ms": 200.0,
+    # Off between ON/OFF fixes, with the RTC running
+    "off_ma": 0.03,
+    "hot_start_s": 1.0,
+    # ESP32 supply currents in mA - CPU at 80MHz servicing the UART, and light sleep
+    "esp32_awake_ma": 25.0,
+    "esp32_light_sleep_ma": 0.8,
+    # What each fix costs the ESP32 with power_sleep()
+    "guard_ms": 50.0,
+    "processing_ms": 5.0,
+    "baudrate": 9600.0,
+    "bytes_per_fix": 300.0,
+}
+
+MODE_NAMES = ["continuous", "cyclic", "ON/OFF"]
+
+# (mode, update period in ms, on_time in s)
+CONFIGURATIONS = [
+    (0, 1000, 0),
+    (1, 1000, 0),
+    (1, 5000, 0),
+    (2, 10000, 0),
+    (2, 60000, 0),
+    (2, 600000, 0),
+]
+
+
+def receiver_ma(mode, period_s, on_time, a):
+    # Average receiver current over one update period
+    if mode == 1:
+        on_s = min(a["cyclic_on_ms"] / 1000, period_s)
+        return (on_s * a["tracking_ma"] + (period_s - on_s) * a["cyclic_idle_ma"]) / period_s
+
+    if mode == 2:
+        on_s = a["hot_start_s"] + on_time
+
+        if on_s < period_s:
+            return (a["hot_start_s"] * a["acquisition_ma"] + on_time * a["tracking_ma"] + (period_s - on_s) * a["off_ma"]) / period_s
+
+    return a["tracking_ma"]
+
+
+def esp32_ma(mode, period_s, power_sleep, a):
+    # Average ESP32 current over one update period
+    if (not power_sleep) or (mode == 0):
+        return a["esp32_awake_ma"]
+
+    awake_s = min((a["guard_ms"] + a["processing_ms"]) / 1000 + a["bytes_per_fix"] * 10 / a["baudrate"], period_s)
+
+    return (awake_s * a["esp32_awake_ma"] + (period_s - awake_s) * a["esp32_light_sleep_ma"]) / period_s
+
+
+def estimate(mode, update_period_ms, on_time, power_sleep, a):
+    # Returns (receiver mA, ESP32 mA, average mW, fixes per joule)
+    period_s = update_period_ms / 1000
+    receiver = receiver_ma(mode, period_s, on_time, a)
+    esp32 = esp32_ma(mode, period_s, power_sleep, a)
+    power_w = (receiver + esp32) / 1000 * a["supply_v"]
+
+    return receiver, esp32, power_w * 1000, (1 / period_s) / power_w
+
+
+def main():
+    assumptions = dict(ASSUMPTIONS)
+    numbers = []
+
+    for argument in sys.argv[1:]:
+        if "=" in argument:
+            name, value = argument.split("=", 1)
+
+            if name not in assumptions:
+                raise SystemExit("Unknown assumption {} - one of {}".format(name, ", ".join(assumptions)))
+            assumptions[name] = float(value)
+        else:
+            numbers.append(int(argument))
+
+    if len(numbers) == 1 or numbers and numbers[0] not in (0, 1, 2):
+        raise SystemExit("Usage: python3 tools/power_estimate.py [mode update_period_ms [on_time]] [name=value ...]")
+
+    configurations = [(numbers[0], numbers[1], numbers[2] if len(numbers) > 2 else 0)] if numbers else CONFIGURATIONS
+
+    print("Assumptions: " + ", ".join("{}={:g}".format(name, value) for name, value in assumptions.items()))
+    print("{:<12}{:>10}{:>9}{:>14}{:>13}{:>11}{:>10}{:>17}".format("mode", "period ms", "on_time", "power_sleep", "receiver mA",
+                                                                   "ESP32 mA", "total mW", "fixes per joule"))
+
+    for mode, update_period_ms, on_time in configurations:
+        for power_sleep in (False, True):
+            receiver, esp32, power_mw, fixes_per_joule = estimate(mode, update_period_ms, on_time, power_sleep, assumptions)
+            print("{:<12}{:>10}{:>9}{:>14}{:>13.2f}{:>11.2f}{:>10.1f}{:>17.3f}".format(MODE_NAMES[mode], update_period_ms, on_time,
+                                                                                     "yes" if power_sleep else "no", receiver, esp32,
+                                                                                     power_mw, fixes_per_joule))
+
+
+if __name__ == "__main__":
+    main()
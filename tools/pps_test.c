@@ -0,0 +1,127 @@
+/**
+ * Host-side test of the C module's PPS time correlation (pps_edge(), pps_pair() and pps_utc_now() in neo_m8_core.c), driven by a
+ * simulated timepulse instead of the GPIO interrupt
+ *
+ * Build and run from the repository root:
+ *     cc -O2 -Iembedded_c_module tools/pps_test.c embedded_c_module/neo_m8_core.c -o pps_test && ./pps_test [seconds] [seed]
+ *
+ * The simulation runs the ESP32's esp_timer 20ppm fast against true time. It fires a timepulse edge at the start of every UTC second,
+ * latched up to 5us late (interrupt latency), and delivers each second's whole-second sentence 80-450ms after its edge. On top of that:
+ *  - after the first 10s, 2% of reads are stalled past the next edge, so pps_pair() sees a sentence that is already a second old
+ *    (the first pairing isn't, as one from a late read is a second out until an on-time read puts it right)
+ *  - every 10 minutes, 30 reads in a row are late like that (a loop polling just after each edge)
+ *  - 0.1% of edges are missed, and 0.1% are followed by a glitch edge 1-300ms later
+ * Between reads, the interpolated UTC time is checked against the true time. Exits with 1 if any check is off by more than
+ * PPS_TOLERANCE_US, or if a time is returned before the first pairing.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "neo_m8_core.h"
+
+#define PPS_TOLERANCE_US 50
+#define CLOCK_DRIFT_PPM 20
+#define UTC_START_US 1704067200000000LL
+#define ESP_TIMER_START_US 1234567LL
+
+static uint64_t random_state;
+
+static uint32_t random_u32(void){
+	// xorshift64 - reproducible for a given seed on every host
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+
+	return random_state >> 32;
+}
+
+static int64_t random_between(int64_t low, int64_t high){
+	return low + (int64_t)(random_u32() % (uint32_t)(high - low + 1));
+}
+
+static int64_t esp_time(int64_t true_us){
+	// esp_timer reading at a true time (us since the simulation started)
+	return ESP_TIMER_START_US + true_us + true_us * CLOCK_DRIFT_PPM / 1000000;
+}
+
+static void fire_edges(pps_t* pps, int64_t* next_edge_us, int64_t until_us){
+	// Fires every timepulse edge up to a true time, as the GPIO ISR would - some missed, some followed by a glitch
+	while (*next_edge_us <= until_us){
+		if (random_u32() % 1000 != 0){
+			pps_edge(pps, esp_time(*next_edge_us) + random_between(0, 5));
+		}
+
+		if (random_u32() % 1000 == 0){
+			pps_edge(pps, esp_time(*next_edge_us) + random_between(1000, 300000));
+		}
+
+		*next_edge_us += 1000000;
+	}
+}
+
+int main(int argc, char** argv){
+	int64_t seconds = (argc > 1) ? atoll(argv[1]) : 3600;
+	int64_t next_edge_us = 0, read_us, query_us, reader_free_us = 0, error_us, max_error_us = 0, error_sum_us = 0;
+	int64_t second, utc_us;
+	uint32_t checks = 0, late_reads = 0, failures = 0;
+	pps_t pps = {0};
+
+	random_state = (argc > 2) ? strtoull(argv[2], NULL, 0) : 0x4E4D3850;
+
+	for (second = 0; second < seconds; second++){
+		// This second's sentence is read after a normal UART/parsing delay, or stalled past the next edge, but never before the reader
+		// has finished with the previous one
+		if ((second >= 10) && ((random_u32() % 100 < 2) || (second % 600 >= 570))){
+			read_us = second*1000000 + random_between(1050000, 1400000);
+			late_reads++;
+		}
+		else {
+			read_us = second*1000000 + random_between(80000, 450000);
+		}
+
+		if (read_us < reader_free_us){
+			read_us = reader_free_us;
+		}
+		reader_free_us = read_us + 1000;
+
+		// Every edge up to the read has fired by then
+		fire_edges(&pps, &next_edge_us, read_us);
+
+		if ((pps.paired_count == 0) && (pps_utc_now(&pps, esp_time(read_us)) != 0)){
+			printf("pps_utc_now() returned a time before the first pairing\n");
+			failures++;
+		}
+
+		pps_pair(&pps, esp_time(read_us), UTC_START_US + second*1000000);
+
+		// Checking the interpolation at a few points before the next read could happen, firing any edges on the way
+		for (int i = 0; (i < 4) && (pps.paired_count != 0); i++){
+			query_us = read_us + random_between(0, 999999);
+
+			fire_edges(&pps, &next_edge_us, query_us);
+
+			utc_us = pps_utc_now(&pps, esp_time(query_us));
+			error_us = utc_us - (UTC_START_US + query_us);
+			error_us = (error_us < 0) ? -error_us : error_us;
+
+			if (error_us > PPS_TOLERANCE_US){
+				if (failures < 10){
+					printf("second %lld: interpolated UTC off by %lld us\n", (long long)second, (long long)error_us);
+				}
+				failures++;
+			}
+
+			max_error_us = (error_us > max_error_us) ? error_us : max_error_us;
+			error_sum_us += error_us;
+			checks++;
+		}
+	}
+
+	printf("%lld s simulated, %u late reads, %u checks: max error %lld us, mean %.1f us (tolerance %d us)\n", (long long)seconds,
+	       late_reads, checks, (long long)max_error_us, checks ? (double)error_sum_us / checks : 0.0, PPS_TOLERANCE_US);
+	printf("%s\n", failures ? "FAIL" : "OK");
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * Host-side benchmark of the C module's binary track log encoder (track_start(), track_append() and track_pad_block() in neo_m8_core.c)
+ * Normally run by tools/track_bench.py, which builds it, decodes its output with tools/track_decode.py and checks the round trip
+ *
+ * Usage: track_bench track.bin expected.csv fixes rate_hz speed_ms
+ *
+ * Encodes a synthetic track of the given number of fixes at the given rate, wandering at around the given speed, the way track_log_fix()
+ * does - whole blocks, each padded out once the next fix won't fit. Positions change smoothly apart from a small receiver noise (about 1cm
+ * horizontally, 1cm vertically), and times are whole epochs. The encoding (blocks kept in memory, no file writes) is timed, best of five
+ * passes, then the blocks are written to track.bin and the fixes to expected.csv as integers (time ms, latitude, longitude, altitude,
+ * speed). Prints one line: fixes=<count> bytes=<file size> ns_per_fix=<encoding time>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "neo_m8_core.h"
+
+#define PASSES 5
+#define UTC_START_US 1704067200000000LL
+#define START_LATITUDE 52.2053
+#define START_LONGITUDE 0.1218
+
+static uint64_t random_state = 0x4E4D3854;
+
+static double random_uniform(void){
+	// xorshift64, in [-1, 1)
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+
+	return (random_state >> 11) / 4503599627370496.0 - 1;
+}
+
+static double now_ns(void){
+	struct timespec time;
+
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return time.tv_sec*1e9 + time.tv_nsec;
+}
+
+static uint32_t encode(const fix_record_t* records, long count, uint8_t* blocks){
+	// Encodes every fix into consecutive blocks, returning how many were used
+	track_encoder_t encoder;
+	uint16_t block_length;
+	uint32_t block_count = 0;
+	long i;
+
+	track_start(&encoder, blocks, &block_length);
+
+	for (i = 0; i < count; i++){
+		if (!track_append(&encoder, &records[i], blocks + (size_t)block_count*TRACK_BLOCK_LENGTH, &block_length)){
+			track_pad_block(blocks + (size_t)block_count*TRACK_BLOCK_LENGTH, block_length);
+			block_count++;
+			block_length = 0;
+			track_append(&encoder, &records[i], blocks + (size_t)block_count*TRACK_BLOCK_LENGTH, &block_length);
+		}
+	}
+
+	// log_stop() writes out the last, partly filled block
+	if (block_length > 0){
+		track_pad_block(blocks + (size_t)block_count*TRACK_BLOCK_LENGTH, block_length);
+		block_count++;
+	}
+
+	return block_count;
+}
+
+int main(int argc, char** argv){
+	long count, i;
+	double rate_hz, speed_ms, heading = 0, speed, north_m = 0, east_m = 0, altitude_m = 30;
+	double start_ns, pass_ns, best_ns = 1e30, lon_mm_per_degree = MM_PER_DEGREE * cos(START_LATITUDE * 0.017453292519943295);
+	fix_record_t* records;
+	uint8_t* blocks;
+	uint32_t block_count = 0;
+	FILE *track_file, *expected_file;
+	int pass;
+
+	if (argc < 6){
+		printf("Usage: track_bench track.bin expected.csv fixes rate_hz speed_ms\n");
+		return 1;
+	}
+
+	count = atol(argv[3]);
+	rate_hz = atof(argv[4]);
+	speed_ms = atof(argv[5]);
+	speed = speed_ms;
+
+	records = malloc(count * sizeof(fix_record_t));
+	// Worst case is one block per TRACK_BLOCK_LENGTH/TRACK_RECORD_MAX_LENGTH fixes, plus the first
+	blocks = malloc(((size_t)count / (TRACK_BLOCK_LENGTH / TRACK_RECORD_MAX_LENGTH) + 2) * TRACK_BLOCK_LENGTH);
+
+	if ((records == NULL) || (blocks == NULL)){
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	// A wandering track - heading and speed drift, altitude follows gentle terrain
+	for (i = 0; i < count; i++){
+		heading += 0.05 * random_uniform();
+		speed += 0.02 * speed_ms * random_uniform() + 0.01 * (speed_ms - speed);
+		speed = (speed < 0) ? 0 : speed;
+		north_m += speed * cos(heading) / rate_hz;
+		east_m += speed * sin(heading) / rate_hz;
+		altitude_m += 0.02 * speed * random_uniform() / rate_hz;
+
+		records[i].utc_us = UTC_START_US + (int64_t)llround(i * 1e6 / rate_hz);
+		records[i].latitude_e7 = llround(START_LATITUDE*1e7 + north_m * 1e3 * 1e7 / MM_PER_DEGREE + random_uniform());
+		records[i].longitude_e7 = llround(START_LONGITUDE*1e7 + east_m * 1e3 * 1e7 / lon_mm_per_degree + random_uniform());
+		records[i].altitude_mm = llround(altitude_m * 1000 + 10 * random_uniform());
+		records[i].speed_cms = llround(speed * 100);
+	}
+
+	for (pass = 0; pass < PASSES; pass++){
+		start_ns = now_ns();
+		block_count = encode(records, count, blocks);
+		pass_ns = now_ns() - start_ns;
+		best_ns = (pass_ns < best_ns) ? pass_ns : best_ns;
+	}
+
+	track_file = fopen(argv[1], "wb");
+	expected_file = fopen(argv[2], "w");
+
+	if ((track_file == NULL) || (expected_file == NULL)){
+		printf("Can't open output files\n");
+		return 1;
+	}
+
+	fwrite(blocks, TRACK_BLOCK_LENGTH, block_count, track_file);
+	fclose(track_file);
+
+	for (i = 0; i < count; i++){
+		fprintf(expected_file, "%lld,%ld,%ld,%ld,%u\n", (long long)(records[i].utc_us / 1000), (long)records[i].latitude_e7,
+		        (long)records[i].longitude_e7, (long)records[i].altitude_mm, records[i].speed_cms);
+	}
+	fclose(expected_file);
+
+	printf("fixes=%ld bytes=%lu ns_per_fix=%.1f\n", count, (unsigned long)block_count * TRACK_BLOCK_LENGTH, best_ns / count);
+
+	free(records);
+	free(blocks);
+
+	return 0;
+}
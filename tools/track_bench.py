@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Host-side benchmark of the C module's binary track log - bytes per fix and encoding CPU time per fix.
+
+Usage: python3 tools/track_bench.py [fixes] [cc]
+
+Builds tools/track_bench.c against embedded_c_module/neo_m8_core.c (the encoder the driver uses), and runs it for a few synthetic
+tracks. Each track file is decoded back with track_decode.py and checked fix by fix against what was encoded. Bytes per fix are the
+file size (padding included) over the number of fixes. CPU per fix is the host encoding time, not the ESP32's.
+"""
+
+import sys, os, subprocess, tempfile
+
+import track_decode
+
+# (name, rate in Hz, typical speed in m/s)
+TRACKS = [
+    ("10Hz vehicle", 10, 15.0),
+    ("1Hz vehicle", 1, 15.0),
+    ("1Hz walking", 1, 1.4),
+    ("1Hz stationary", 1, 0.0),
+]
+
+
+def build(directory, compiler):
+    tools = os.path.dirname(os.path.abspath(__file__))
+    module = os.path.join(tools, "..", "embedded_c_module")
+    binary = os.path.join(directory, "track_bench")
+
+    subprocess.check_call([compiler, "-O2", "-I" + module, os.path.join(tools, "track_bench.c"), os.path.join(module, "neo_m8_core.c"),
+                           "-lm", "-o", binary])
+
+    return binary
+
+
+def run(binary, directory, fixes, rate_hz, speed_ms):
+    track_path = os.path.join(directory, "track.bin")
+    expected_path = os.path.join(directory, "expected.csv")
+
+    output = subprocess.check_output([binary, track_path, expected_path, str(fixes), str(rate_hz), str(speed_ms)]).decode()
+    results = dict(item.split("=") for item in output.split())
+
+    with open(track_path, "rb") as file:
+        decoded = track_decode.decode(file.read())
+
+    with open(expected_path) as file:
+        expected = [tuple(int(value) for value in line.split(",")) for line in file]
+
+    if decoded != expected:
+        mismatch = next((i for i, (a, b) in enumerate(zip(decoded, expected)) if a != b), min(len(decoded), len(expected)))
+        raise ValueError("Decoded track differs from the encoded one at fix {} ({} decoded, {} encoded)".format(mismatch, len(decoded),
+                                                                                                             len(expected)))
+
+    return int(results["bytes"]) / int(results["fixes"]), float(results["ns_per_fix"])
+
+
+def main():
+    fixes = int(sys.argv[1]) if len(sys.argv) > 1 else 100000
+    compiler = sys.argv[2] if len(sys.argv) > 2 else "cc"
+
+    with tempfile.TemporaryDirectory() as directory:
+        binary = build(directory, compiler)
+
+        print("{:<16}{:>8}{:>16}{:>14}".format("track", "fixes", "bytes per fix", "ns per fix"))
+
+        for name, rate_hz, speed_ms in TRACKS:
+            bytes_per_fix, ns_per_fix = run(binary, directory, fixes, rate_hz, speed_ms)
+            print("{:<16}{:>8}{:>16.2f}{:>14.1f}".format(name, fixes, bytes_per_fix, ns_per_fix))
+
+    print("All tracks decoded back exactly")
+
+
+if __name__ == "__main__":
+    main()
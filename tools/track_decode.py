@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Host-side decoder for the binary track logs written by the C module's log_start()/log_stop().
+
+Usage: python3 track_decode.py track.bin [output.csv]
+
+Writes one CSV row per fix: UTC time (ISO 8601), latitude, longitude (degrees), altitude (m), speed (m/s).
+
+File format:
+    8-byte header: b"NM8T", format version, reserved, block length (uint16, little-endian)
+    Blocks of the given length (the first one starting straight after the header), each padded with 0xFF.
+    Records: a tag byte then five zigzag varints - time (ms since 1970-01-01 UTC), latitude, longitude (1e-7 degrees),
+    altitude (mm), speed (cm/s). Tag 0x01 is a keyframe holding absolute values, tag 0x00 holds the change since the
+    previous fix. Every block starts with a keyframe, so decoding can start at any block boundary.
+"""
+
+import sys, struct, datetime
+
+TAG_DELTA = 0x00
+TAG_KEYFRAME = 0x01
+TAG_PADDING = 0xFF
+
+
+def read_varint(data, index):
+    value = 0
+    shift = 0
+
+    while True:
+        byte = data[index]
+        index += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+
+        if byte < 0x80:
+            break
+
+    # Undoing the zigzag encoding
+    return (value >> 1) ^ -(value & 1), index
+
+
+def decode_block(block, fixes):
+    index = 0
+    current = None
+
+    while index < len(block) and block[index] != TAG_PADDING:
+        tag = block[index]
+        values = []
+        index += 1
+
+        for _ in range(5):
+            value, index = read_varint(block, index)
+            values.append(value)
+
+        if tag == TAG_KEYFRAME:
+            current = values
+        elif tag == TAG_DELTA and current is not None:
+            current = [a + b for a, b in zip(current, values)]
+        else:
+            raise ValueError("Corrupt record at block offset {}".format(index))
+
+        fixes.append(tuple(current))
+
+
+def decode(data):
+    magic, version, _, block_length = struct.unpack_from("<4sBBH", data, 0)
+
+    if magic != b"NM8T":
+        raise ValueError("Not a track log")
+    if version != 1:
+        raise ValueError("Unsupported track log version {}".format(version))
+
+    fixes = []
+    decode_block(data[8:block_length], fixes)
+
+    for start in range(block_length, len(data), block_length):
+        decode_block(data[start:start + block_length], fixes)
+
+    return fixes
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as file:
+        fixes = decode(file.read())
+
+    output = open(sys.argv[2], "w") if len(sys.argv) > 2 else sys.stdout
+    output.write("utc,latitude,longitude,altitude,speed\n")
+
+    for utc_ms, latitude, longitude, altitude, speed in fixes:
+        utc = datetime.datetime.fromtimestamp(utc_ms / 1000, datetime.timezone.utc)
+        output.write("{},{:.7f},{:.7f},{:.3f},{:.2f}\n".format(utc.isoformat(timespec="milliseconds").replace("+00:00", "Z"),
+                                                                latitude / 1e7, longitude / 1e7, altitude / 1000, speed / 100))
+
+    if output is not sys.stdout:
+        output.close()
+
+
+if __name__ == "__main__":
+    main()